@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "bench.h"
+
+namespace {
+	struct Case {
+		std::string name;
+		hgs::bench::Function function;
+		hgs::bench::Setup setup;
+	};
+
+	std::vector<Case>& Cases() {
+		static std::vector<Case> cases;
+		return cases;
+	}
+
+	double TimeBatch(const hgs::bench::Function& function, hgs::bench::State& state) {
+		const auto start = std::chrono::steady_clock::now();
+		function(state);
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	void AppendEscaped(std::string& out, const std::string& string) {
+		for (char character : string) {
+			if (character == '"' || character == '\\') {
+				out.push_back('\\');
+			}
+			out.push_back(character);
+		}
+	}
+}
+
+void hgs::bench::Register(const std::string& name, Function function, Setup setup) {
+	Cases().push_back({ name, std::move(function), std::move(setup) });
+}
+
+std::vector<hgs::bench::Result> hgs::bench::RunAll(const Settings& settings) {
+	std::vector<Result> results;
+
+	printf("%-58s %14s %12s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "min ns/op", "MB/s");
+
+	for (auto& benchCase : Cases()) {
+		if (!settings.filter.empty() && benchCase.name.find(settings.filter) == std::string::npos) {
+			continue;
+		}
+		if (benchCase.setup) {
+			benchCase.setup();
+		}
+
+		// Grow the batch until it runs for at least minTime, this also warms up caches
+		uint64_t iterations = 1;
+		while (true) {
+			State state(iterations);
+			const double elapsed = TimeBatch(benchCase.function, state);
+			if (elapsed >= settings.minTime || iterations >= (uint64_t(1) << 40)) break;
+
+			const double scale = elapsed > 0.0 ? settings.minTime / elapsed * 1.2 : 10.0;
+			iterations = std::max<uint64_t>(iterations + 1, static_cast<uint64_t>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+		}
+
+		std::vector<double> samples;
+		uint64_t bytes = 0;
+		for (int i = 0; i < settings.repetitions; i++) {
+			State state(iterations);
+			samples.push_back(TimeBatch(benchCase.function, state) * 1e9 / static_cast<double>(iterations));
+			bytes = state.GetBytesPerIteration();
+		}
+		std::sort(samples.begin(), samples.end());
+
+		Result result;
+		result.name = benchCase.name;
+		result.iterations = iterations;
+		result.nsPerOp = samples[samples.size() / 2];
+		result.minNsPerOp = samples.front();
+		result.maxNsPerOp = samples.back();
+		result.bytesPerSecond = bytes > 0 && result.nsPerOp > 0.0 ? static_cast<double>(bytes) * 1e9 / result.nsPerOp : 0.0;
+		results.push_back(result);
+
+		printf("%-58s %14llu %12.1f %12.1f %12.1f\n", result.name.c_str(),
+			static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.minNsPerOp,
+			result.bytesPerSecond / 1e6);
+	}
+	return results;
+}
+
+bool hgs::bench::WriteJson(const std::string& path, const std::vector<Result>& results) {
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	std::string out = "{\n  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		char numbers[256];
+		snprintf(numbers, sizeof(numbers),
+			"\"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f, \"bytes_per_second\": %.1f",
+			static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.minNsPerOp, result.maxNsPerOp, result.bytesPerSecond);
+
+		out.append(i == 0 ? "\n" : ",\n");
+		out.append("    {\"name\": \"");
+		AppendEscaped(out, result.name);
+		out.append("\", ");
+		out.append(numbers);
+		out.append("}");
+	}
+	out.append("\n  ]\n}\n");
+	file << out;
+	return true;
+}
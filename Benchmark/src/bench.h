@@ -0,0 +1,86 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Bench.h
+	Purpose: Minimal microbenchmark harness. Every case is timed over
+	repeated batches, the median batch is reported and all results can
+	be written as JSON so builds can be diffed
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+	namespace bench {
+
+		class State {
+		public:
+			State(uint64_t iterations) : iterations_(iterations), bytes_(0) {};
+
+			uint64_t Iterations() const { return iterations_; };
+			/**
+				Bytes processed per iteration, reported
+				as throughput when set
+
+				@return void
+			 */
+			void SetBytesPerIteration(uint64_t bytes) { bytes_ = bytes; };
+			uint64_t GetBytesPerIteration() const { return bytes_; };
+		private:
+			const uint64_t iterations_;
+			uint64_t bytes_;
+		};
+
+		struct Result {
+			std::string name;
+			uint64_t iterations = 0;
+			double nsPerOp = 0.0;
+			double minNsPerOp = 0.0;
+			double maxNsPerOp = 0.0;
+			double bytesPerSecond = 0.0;
+		};
+
+		struct Settings {
+			// Substring a case name must contain to run
+			std::string filter;
+			std::string jsonPath;
+			// Timed batches per case, the median is reported
+			int repetitions = 5;
+			// Minimum wall time of one batch in seconds
+			double minTime = 0.05;
+		};
+
+		using Function = std::function<void(State&)>;
+		using Setup = std::function<void()>;
+
+		/**
+			Register a case, parameterized cases register
+			one name per parameter combination
+
+			@param setup Optional fixture work run once before timing starts
+			@return void
+		 */
+		void Register(const std::string& name, Function function, Setup setup = nullptr);
+		/**
+			Run all registered cases matching the filter
+			and print a table
+
+			@return std::vector<Result>
+		 */
+		std::vector<Result> RunAll(const Settings& settings);
+		/**
+			Write results as JSON
+
+			@return bool False if the file could not be opened
+		 */
+		bool WriteJson(const std::string& path, const std::vector<Result>& results);
+
+		// Keep the compiler from optimizing away a computed value
+		template <typename T>
+		inline void DoNotOptimize(const T& value) {
+			volatile const char* sink = reinterpret_cast<volatile const char*>(&value);
+			(void)*sink;
+		}
+	}
+}
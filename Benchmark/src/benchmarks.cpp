@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "bench.h"
+#include "benchmarks.h"
+#include "client.h"
+#include "lobby.h"
+#include "utilities.h"
+#include "interest.h"
+#include "transport.h"
+#include "clock.h"
+
+namespace {
+	// Clients never touch a real socket, every one gets a unique fake handle so their loggers don't collide
+	SOCKET nextSocket = 1 << 20;
+	int nextClientId = 1000;
+	int nextLobbyName = 0;
+
+	const int lobbySizes[] = { 8, 64, 256 };
+	const int messageSizes[] = { 32, 256 };
+	const int payloadSizes[] = { 16, 128, 1000 };
+	const int scaleLobbies[] = { 16, 256, 1024 };
+	// Clients spread over a world sized so about interestNeighbours fall within the radius
+	const int interestSizes[] = { 256, 1024, 4096 };
+	const float interestRadius = 100.0f;
+	const float interestNeighbours = 16.0f;
+	// Clients in every lobby of the lookup benchmarks
+	const int scaleClientsPerLobby = 16;
+
+	void Quiet() { spdlog::set_level(spdlog::level::off); }
+
+	/**
+		Connection without a remote end, every read returns
+		the same message and sends are dropped, so only the
+		engine's own work is timed
+	 */
+	class BenchTransport : public hgs::Transport {
+	public:
+		BenchTransport(const SOCKET handle, std::string message) : handle_(handle), message_(std::move(message)) {};
+
+		int Receive(char* buffer, const int length) override {
+			const int bytes = std::min(static_cast<int>(message_.size()) + 1, length);
+			memcpy(buffer, message_.c_str(), static_cast<size_t>(bytes));
+			return bytes;
+		};
+		int Send(const char*, const int length) override { return length; };
+		bool Ready() override { return true; };
+		void Close() override {};
+		SOCKET GetHandle() const override { return handle_; };
+	private:
+		const SOCKET handle_;
+		const std::string message_;
+	};
+
+	/**
+		Clock of a benchmarked lobby. Instead of sleeping while
+		the lobby waits for its clients, the clients are stepped
+		on the calling thread like Client::Loop would
+	 */
+	class SteppingClock : public hgs::Clock {
+	public:
+		int64_t Now() const override { return hgs::utilities::NowMicroseconds(); };
+		void Sleep(std::chrono::microseconds) override {
+			for (hgs::Client* client : members) {
+				client->Step();
+			}
+		};
+
+		std::vector<hgs::Client*> members;
+	};
+
+	hgs::Client* NewClient(hgs::SharedMemory* memory, const int lobby_id, const std::string& message = "") {
+		return new hgs::Client(std::make_unique<BenchTransport>(nextSocket++, message), memory, nextClientId++, lobby_id);
+	}
+
+	std::string Payload(const int size) {
+		// Field separated game state, similar to what clients send
+		std::string payload;
+		int field = 0;
+		while (static_cast<int>(payload.size()) < size) {
+			payload.append(std::to_string(field++ * 37 % 1000));
+			payload.push_back('|');
+		}
+		payload.resize(static_cast<size_t>(size));
+		return payload;
+	}
+
+	std::vector<hgs::Message> Queue(const int senders, const int first_id, const int size) {
+		std::vector<hgs::Message> queue;
+		const std::string payload = Payload(size);
+		for (int i = 0; i < senders; i++) {
+			hgs::Message message;
+			message.sender = first_id + i;
+			message.frame = "{" + std::to_string(message.sender) + "|" + payload + "}";
+			queue.push_back(message);
+		}
+		return queue;
+	}
+
+	// Lobbies and clients for the lookup benchmarks, grown as the cases ask for more
+	struct ScalePool {
+		std::vector<hgs::Lobby*> lobbies;
+		int lastClientId = 0;
+
+		void Grow(hgs::SharedMemory* memory, const size_t count) {
+			while (lobbies.size() < count) {
+				hgs::Lobby* lobby = memory->AddLobby("scale" + std::to_string(nextLobbyName++), false);
+				for (int i = 0; i < scaleClientsPerLobby; i++) {
+					hgs::Client* client = NewClient(memory, lobby->GetId());
+					lobby->AddClient(client, false);
+					lastClientId = client->id;
+				}
+				lobbies.push_back(lobby);
+			}
+			Quiet();
+		}
+	};
+	ScalePool pool;
+}
+
+void hgs::RegisterBenchmarks(Core& core) {
+	SharedMemory* memory = core.GetSharedMemory();
+	Client* probe = NewClient(memory, memory->GetMainLobby()->GetId());
+	Quiet();
+
+	// Protocol parsing
+
+	for (int size : payloadSizes) {
+		const std::string frame = "{12|" + Payload(size) + "}";
+		bench::Register("Client::Split/bytes:" + std::to_string(size), [probe, frame](bench::State& state) {
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(probe->Split(frame));
+			}
+			state.SetBytesPerIteration(frame.size());
+		});
+	}
+
+	for (int size : payloadSizes) {
+		std::string payload = Payload(size);
+		bench::Register("Client::IsApiCall/bytes:" + std::to_string(size), [payload](bench::State& state) mutable {
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(Client::IsApiCall(payload));
+			}
+			state.SetBytesPerIteration(payload.size());
+		});
+	}
+
+	// Payload composition, one recipient and the whole lobby
+
+	for (int lobbySize : lobbySizes) {
+		for (int messageSize : messageSizes) {
+			const std::string suffix = "/lobby:" + std::to_string(lobbySize) + "/msg:" + std::to_string(messageSize);
+
+			Client* recipient = NewClient(memory, -1);
+			std::vector<Message> queue = Queue(lobbySize, recipient->id, messageSize);
+			bench::Register("Client::Send" + suffix, [recipient, queue](bench::State& state) mutable {
+				for (uint64_t i = 0; i < state.Iterations(); i++) {
+					recipient->SetOutgoing(queue);
+					recipient->Send();
+				}
+				state.SetBytesPerIteration(static_cast<uint64_t>(queue.size()) * queue[0].frame.size());
+			});
+
+			// A whole lobby tick: the receive phase collects one frame from every
+			// client and the send phase fans the queue out to all of them
+			SteppingClock* clock = new SteppingClock();
+			Clock* system = &memory->GetClock();
+			// The lobby and its clients read the clock when they are created
+			memory->SetClock(clock);
+			Lobby* lobby = memory->AddLobby("fanout" + std::to_string(nextLobbyName++), false);
+			const std::string message = Payload(messageSize);
+			for (int i = 0; i < lobbySize; i++) {
+				Client* client = NewClient(memory, lobby->GetId(), message);
+				lobby->AddClient(client, false);
+				clock->members.push_back(client);
+			}
+			memory->SetClock(system);
+			bench::Register("Lobby::Loop" + suffix, [lobby, lobbySize, message](bench::State& state) {
+				for (uint64_t i = 0; i < state.Iterations(); i++) {
+					lobby->Loop();
+					lobby->Loop();
+				}
+				// Every client gets the frames of everyone else
+				state.SetBytesPerIteration(static_cast<uint64_t>(lobbySize) * (lobbySize - 1) * message.size());
+			});
+		}
+	}
+	Quiet();
+
+	// Compression of a lobby's frames, done once per tick
+
+	for (int lobbySize : lobbySizes) {
+		std::string frames;
+		for (auto& message : Queue(lobbySize, 1, messageSizes[0])) {
+			frames.append(message.frame);
+		}
+		const Compressor* compressor = &memory->GetCompressor();
+		const std::string suffix = "/lobby:" + std::to_string(lobbySize) + "/msg:" + std::to_string(messageSizes[0]);
+
+		bench::Register("Compressor::Compress" + suffix, [compressor, frames](bench::State& state) {
+			std::string compressed;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				compressor->Compress(frames.data(), frames.size(), compressed);
+				bench::DoNotOptimize(compressed);
+			}
+			state.SetBytesPerIteration(frames.size());
+		});
+
+		std::string compressed;
+		compressor->Compress(frames.data(), frames.size(), compressed);
+		bench::Register("Compressor::Decompress" + suffix, [compressor, compressed, frames](bench::State& state) {
+			std::string decompressed;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				compressor->Decompress(compressed.data(), compressed.size(), decompressed);
+				bench::DoNotOptimize(decompressed);
+			}
+			state.SetBytesPerIteration(frames.size());
+		});
+	}
+
+	// Interest management, the grid update and the neighbour query of one recipient
+
+	for (int clients : interestSizes) {
+		const std::string suffix = "/clients:" + std::to_string(clients);
+		const float world = std::sqrt(static_cast<float>(clients) * 3.14159f * interestRadius * interestRadius / interestNeighbours);
+
+		auto grid = std::make_shared<InterestGrid>(interestRadius, interestRadius);
+		auto positions = std::make_shared<std::vector<Position>>();
+		std::mt19937 random(static_cast<unsigned int>(clients));
+		std::uniform_real_distribution<float> place(0.0f, world);
+		for (int slot = 0; slot < clients; slot++) {
+			positions->push_back({ place(random), place(random) });
+			grid->Move(slot, positions->back());
+		}
+
+		bench::Register("InterestGrid::Move" + suffix, [grid, positions](bench::State& state) {
+			// Every client takes a small step back and forth, some cross a cell border
+			float step = 1.0f;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				for (size_t slot = 0; slot < positions->size(); slot++) {
+					Position position = (*positions)[slot];
+					position.x += step;
+					grid->Move(static_cast<int>(slot), position);
+				}
+				step = -step;
+			}
+		});
+		bench::Register("InterestGrid::Query" + suffix, [grid, clients](bench::State& state) {
+			std::vector<int> slots;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				grid->Query(static_cast<int>(i % static_cast<uint64_t>(clients)), slots);
+				bench::DoNotOptimize(slots);
+			}
+		});
+	}
+
+	// Position header of a frame, parsed from text and read from the typed form
+
+	std::string typedPosition;
+	PositionSchema::Encode(typedPosition, PositionSchema::Tuple{ 512.25f, -1024.5f });
+	const std::vector<std::pair<std::string, std::string>> positionFrames = {
+		{ "text", "@p=512.25,-1024.5@" + Payload(64) },
+		{ "typed", typedPosition + Payload(64) }
+	};
+	for (const auto& frame : positionFrames) {
+		const std::string input = frame.second;
+		bench::Register("ReadPosition/" + frame.first, [input](bench::State& state) {
+			Position position;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(ReadPosition(input, position));
+			}
+		});
+	}
+
+	// Console and rcon commands
+
+	const std::vector<std::pair<std::string, std::string>> commands = {
+		{ "help", "/help" },
+		{ "lobby_list", "/Lobby list" },
+		{ "lobby_client_list", "/Lobby main list" },
+		{ "client_drop_miss", "/Client 99999999 drop" },
+		{ "unknown", "/Unknown command with arguments" }
+	};
+	for (auto& command : commands) {
+		const std::string input = command.second;
+		Core* target = &core;
+		bench::Register("Core::Interpreter/" + command.first, [target, input](bench::State& state) {
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				std::string copy = input;
+				bench::DoNotOptimize(target->ServerCommand(copy));
+			}
+		});
+	}
+
+	// Lookups over every lobby and client
+
+	for (int lobbies : scaleLobbies) {
+		const std::string suffix = "/lobbies:" + std::to_string(lobbies) + "/clients:" + std::to_string(lobbies * scaleClientsPerLobby);
+		const size_t count = static_cast<size_t>(lobbies);
+		const bench::Setup grow = [memory, count]() { pool.Grow(memory, count); };
+
+		bench::Register("SharedMemory::FindClient/last" + suffix, [memory](bench::State& state) {
+			const int id = pool.lastClientId;
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(memory->FindClient(id));
+			}
+		}, grow);
+		bench::Register("SharedMemory::FindClient/miss" + suffix, [memory](bench::State& state) {
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(memory->FindClient(-2));
+			}
+		}, grow);
+		bench::Register("SharedMemory::FindLobby/id" + suffix, [memory](bench::State& state) {
+			const int id = pool.lobbies.back()->GetId();
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(memory->FindLobby(id));
+			}
+		}, grow);
+		bench::Register("SharedMemory::FindLobby/name" + suffix, [memory](bench::State& state) {
+			std::string name = pool.lobbies.back()->GetNameTag();
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(memory->FindLobby(name));
+			}
+		}, grow);
+	}
+
+	// Number parsing, non-numeric input takes the exception path
+
+	const std::vector<std::pair<std::string, std::string>> numbers = {
+		{ "int", "12345" },
+		{ "negative", "-42" },
+		{ "name", "lobbyname" },
+		{ "empty", "" }
+	};
+	for (auto& number : numbers) {
+		std::string input = number.second;
+		bench::Register("utilities::IsInt/" + number.first, [input](bench::State& state) mutable {
+			for (uint64_t i = 0; i < state.Iterations(); i++) {
+				bench::DoNotOptimize(utilities::IsInt(input));
+			}
+		});
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "core.h"
+
+/**
+	Benchmarks.h
+	Purpose: Microbenchmarks of the protocol and tick hot paths
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+	/**
+		Build the fixtures and register every
+		benchmark case with the harness
+
+		@param core A running core, its shared memory holds all fixtures
+		@return void
+	 */
+	void RegisterBenchmarks(Core& core);
+}
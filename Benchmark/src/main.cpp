@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "bench.h"
+#include "benchmarks.h"
+
+using namespace hgs;
+
+/**
+	main.cpp
+	Purpose: Benchmark entry point. Runs the server core from a scratch
+	directory with a fixed configuration so results are reproducible
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace {
+	void PrintUsage() {
+		std::cout <<
+			"Usage: Benchmark [options]\n\n\
+   --filter <text>      Only run benchmarks whose name contains the text\n\
+   --json <file>        Write the results as JSON\n\
+   --repetitions <n>    Timed batches per benchmark, the median is reported (default 5)\n\
+   --min-time <s>       Minimum duration of one batch (default 0.05)\n\
+   --dir <path>         Scratch directory for configuration and logs (default benchmark_run)\n";
+	}
+
+	void WriteConfiguration() {
+		scl::config_file file("server.conf", scl::config_file::WRITE);
+
+		// Ephemeral port so a running server doesn't collide, no limits and no background traffic
+		file.put("server_port", 0);
+		file.put("clock_speed", 50);
+		file.put("socket_processing_max", 1);
+		file.put("timeout_tries", 30);
+		file.put("timeout_delay", 0.5);
+		file.put("ping_interval", 0);
+		file.put("ping_timeout", 3000);
+		file.put("max_connections", 0);
+		file.put("rcon.enable", "false");
+		file.put("rcon.port", "");
+		file.put("rcon.password", "");
+		file.put("rcon.max_connections", 1);
+		file.put("log_path", "logs/");
+		file.put("lobby.max_connections", 0);
+		file.put("lobby.start_id_at", 1);
+		file.put("lobby.session_logging", "false");
+		file.put("lobby.session_path", "sessions/");
+		file.put("lobby.adaptive_timeout", "false");
+		file.put("start_id_at", 1);
+		file.put("latency.sample_rate", 0);
+
+		file.write_changes();
+		file.close();
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	bench::Settings settings;
+	std::string directory = "benchmark_run";
+
+	for (int i = 1; i < argc; i++) {
+		const std::string option = argv[i];
+		if (option == "--help" || option == "-h") {
+			PrintUsage();
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << option << std::endl;
+			return 1;
+		}
+		const std::string value = argv[++i];
+		try {
+			if (option == "--filter") settings.filter = value;
+			else if (option == "--json") settings.jsonPath = value;
+			else if (option == "--repetitions") settings.repetitions = std::max(1, std::stoi(value));
+			else if (option == "--min-time") settings.minTime = std::stod(value);
+			else if (option == "--dir") directory = value;
+			else {
+				std::cerr << "Unknown option " << option << std::endl;
+				PrintUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			std::cerr << "Bad value for " << option << ": " << value << std::endl;
+			return 1;
+		}
+	}
+
+	// Relative JSON paths are resolved before leaving the working directory
+	if (!settings.jsonPath.empty()) {
+		settings.jsonPath = std::experimental::filesystem::absolute(settings.jsonPath).string();
+	}
+
+	// The core reads and writes server.conf, logs and sessions in the working directory
+	std::experimental::filesystem::create_directory(directory);
+	std::experimental::filesystem::current_path(directory);
+	WriteConfiguration();
+
+	Core core;
+	if (!core.ready) {
+		std::cerr << "Core could not be started" << std::endl;
+		return 1;
+	}
+
+	RegisterBenchmarks(core);
+	const std::vector<bench::Result> results = bench::RunAll(settings);
+
+	if (!settings.jsonPath.empty() && !bench::WriteJson(settings.jsonPath, results)) {
+		std::cerr << "Could not write " << settings.jsonPath << std::endl;
+		return 1;
+	}
+	return 0;
+}
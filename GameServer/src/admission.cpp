@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "admission.h"
+
+hgs::PrefixTrie::PrefixTrie() : size_(0) {
+	nodes_.push_back(Node{ { 0, 0 }, false });
+}
+
+bool hgs::PrefixTrie::Insert(const uint32_t prefix, int length) {
+	length = std::min(std::max(length, 0), 32);
+
+	uint32_t node = 0;
+	for (int depth = 0; depth < length; depth++) {
+		const uint32_t bit = prefix >> (31 - depth) & 1;
+		if (nodes_[node].child[bit] == 0) {
+			// Allocate may grow the vector, the index is taken first
+			const uint32_t created = Allocate();
+			nodes_[node].child[bit] = created;
+		}
+		node = nodes_[node].child[bit];
+	}
+
+	if (nodes_[node].listed) return false;
+	nodes_[node].listed = true;
+	size_++;
+	return true;
+}
+
+bool hgs::PrefixTrie::Remove(const uint32_t prefix, int length) {
+	length = std::min(std::max(length, 0), 32);
+
+	uint32_t path[33];
+	path[0] = 0;
+	for (int depth = 0; depth < length; depth++) {
+		const uint32_t next = nodes_[path[depth]].child[prefix >> (31 - depth) & 1];
+		if (next == 0) return false;
+		path[depth + 1] = next;
+	}
+
+	Node& target = nodes_[path[length]];
+	if (!target.listed) return false;
+	target.listed = false;
+	size_--;
+
+	// Prune the nodes that no longer lead to a listed prefix, the root always stays
+	for (int depth = length; depth > 0; depth--) {
+		const Node& node = nodes_[path[depth]];
+		if (node.listed || node.child[0] != 0 || node.child[1] != 0) break;
+		nodes_[path[depth - 1]].child[prefix >> (32 - depth) & 1] = 0;
+		free_.push_back(path[depth]);
+	}
+	return true;
+}
+
+bool hgs::PrefixTrie::Contains(const uint32_t address) const {
+	uint32_t node = 0;
+	for (int depth = 0; depth < 32; depth++) {
+		if (nodes_[node].listed) return true;
+		node = nodes_[node].child[address >> (31 - depth) & 1];
+		if (node == 0) return false;
+	}
+	return nodes_[node].listed;
+}
+
+std::vector<std::pair<uint32_t, int>> hgs::PrefixTrie::List() const {
+	std::vector<std::pair<uint32_t, int>> result;
+	result.reserve(size_);
+	List(0, 0, 0, result);
+	return result;
+}
+
+bool hgs::PrefixTrie::Parse(const std::string& text, uint32_t& prefix, int& length) {
+	const char* current = text.c_str();
+	uint32_t address = 0;
+	for (int octet = 0; octet < 4; octet++) {
+		if (octet > 0) {
+			if (*current != '.') return false;
+			current++;
+		}
+		if (*current < '0' || *current > '9') return false;
+		char* end = nullptr;
+		const unsigned long value = std::strtoul(current, &end, 10);
+		if (value > 255 || end - current > 3) return false;
+		address = address << 8 | static_cast<uint32_t>(value);
+		current = end;
+	}
+
+	int bits = 32;
+	if (*current == '/') {
+		current++;
+		if (*current < '0' || *current > '9') return false;
+		char* end = nullptr;
+		const unsigned long value = std::strtoul(current, &end, 10);
+		if (value > 32 || end - current > 2) return false;
+		bits = static_cast<int>(value);
+		current = end;
+	}
+	if (*current != '\0') return false;
+
+	// Host bits are dropped so 10.1.2.3/8 lists 10.0.0.0/8
+	prefix = bits == 0 ? 0 : address & ~uint32_t(0) << (32 - bits);
+	length = bits;
+	return true;
+}
+
+std::string hgs::PrefixTrie::Format(const uint32_t prefix, const int length) {
+	return std::to_string(prefix >> 24) + "." + std::to_string(prefix >> 16 & 255) + "." + std::to_string(prefix >> 8 & 255) + "." +
+		std::to_string(prefix & 255) + (length < 32 ? "/" + std::to_string(length) : "");
+}
+
+uint32_t hgs::PrefixTrie::Allocate() {
+	if (!free_.empty()) {
+		const uint32_t node = free_.back();
+		free_.pop_back();
+		nodes_[node] = Node{ { 0, 0 }, false };
+		return node;
+	}
+	nodes_.push_back(Node{ { 0, 0 }, false });
+	return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void hgs::PrefixTrie::List(const uint32_t node, const uint32_t prefix, const int depth, std::vector<std::pair<uint32_t, int>>& result) const {
+	if (nodes_[node].listed) {
+		result.emplace_back(prefix, depth);
+	}
+	for (uint32_t bit = 0; bit < 2; bit++) {
+		if (nodes_[node].child[bit] != 0) {
+			List(nodes_[node].child[bit], prefix | bit << (31 - depth), depth + 1, result);
+		}
+	}
+}
+
+hgs::Admission::Admission() : maxPerAddress_(0), perMicrosecond_(0.0), burst_(0.0), sweepAt_(sweepFloor) {
+}
+
+void hgs::Admission::Configure(const int max_per_address, const int per_minute, const int burst) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	maxPerAddress_ = std::max(max_per_address, 0);
+	perMicrosecond_ = std::max(per_minute, 0) / 60000000.0;
+	burst_ = std::max(burst, 1);
+}
+
+hgs::Admission::Verdict hgs::Admission::Admit(const uint32_t address, const SOCKET socket, const int64_t now) {
+	std::lock_guard<std::mutex> lock(mtx_);
+
+	if (blocked_.Contains(address)) {
+		stats_.blocked++;
+		return verdict_blocked;
+	}
+	// Without limits there is nothing to remember about the address
+	if (maxPerAddress_ == 0 && perMicrosecond_ <= 0.0) {
+		stats_.admitted++;
+		return verdict_admit;
+	}
+
+	if (addresses_.size() >= sweepAt_) {
+		Sweep(now);
+	}
+
+	auto entry = addresses_.find(address);
+	if (entry == addresses_.end()) {
+		AddressState created;
+		created.tokens = burst_;
+		created.refilledAt = now;
+		entry = addresses_.emplace(address, created).first;
+	}
+	AddressState& state = entry->second;
+
+	if (perMicrosecond_ > 0.0) {
+		state.tokens = std::min(state.tokens + static_cast<double>(now - state.refilledAt) * perMicrosecond_, burst_);
+		state.refilledAt = now;
+		if (state.tokens < 1.0) {
+			stats_.flooding++;
+			return verdict_flooding;
+		}
+		state.tokens -= 1.0;
+	}
+	if (maxPerAddress_ > 0) {
+		if (state.connections >= maxPerAddress_) {
+			stats_.crowded++;
+			return verdict_crowded;
+		}
+		state.connections++;
+		sockets_[socket] = address;
+	}
+	stats_.admitted++;
+	return verdict_admit;
+}
+
+void hgs::Admission::Release(const SOCKET socket) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	const auto held = sockets_.find(socket);
+	if (held == sockets_.end()) return;
+
+	const auto entry = addresses_.find(held->second);
+	if (entry != addresses_.end() && entry->second.connections > 0) {
+		entry->second.connections--;
+	}
+	sockets_.erase(held);
+}
+
+bool hgs::Admission::Block(const uint32_t prefix, const int length) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	return blocked_.Insert(prefix, length);
+}
+
+bool hgs::Admission::Unblock(const uint32_t prefix, const int length) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	return blocked_.Remove(prefix, length);
+}
+
+std::vector<std::pair<uint32_t, int>> hgs::Admission::ListBlocked() const {
+	std::lock_guard<std::mutex> lock(mtx_);
+	return blocked_.List();
+}
+
+int hgs::Admission::LoadBlocklist(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) return -1;
+
+	PrefixTrie loaded;
+	std::string line;
+	while (std::getline(file, line)) {
+		line = line.substr(0, line.find('#'));
+		line.erase(std::remove_if(line.begin(), line.end(), [](const char c) { return c == ' ' || c == '\t' || c == '\r'; }), line.end());
+
+		uint32_t prefix = 0;
+		int length = 0;
+		if (!line.empty() && PrefixTrie::Parse(line, prefix, length)) {
+			loaded.Insert(prefix, length);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mtx_);
+	blocked_ = std::move(loaded);
+	return static_cast<int>(blocked_.Size());
+}
+
+bool hgs::Admission::SaveBlocklist(const std::string& path) const {
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) return false;
+	for (auto& prefix : ListBlocked()) {
+		file << PrefixTrie::Format(prefix.first, prefix.second) << "\n";
+	}
+	return true;
+}
+
+hgs::AdmissionStats hgs::Admission::GetStats() const {
+	std::lock_guard<std::mutex> lock(mtx_);
+	return stats_;
+}
+
+std::string hgs::Admission::ToString() const {
+	std::lock_guard<std::mutex> lock(mtx_);
+	return std::to_string(stats_.admitted) + " admitted, " + std::to_string(stats_.blocked) + " blocked, " + std::to_string(stats_.crowded) +
+		" over the connections and " + std::to_string(stats_.flooding) + " over the rate of their address, " + std::to_string(blocked_.Size()) +
+		" blocked prefixes, " + std::to_string(addresses_.size()) + " tracked addresses";
+}
+
+void hgs::Admission::Sweep(const int64_t now) {
+	for (auto entry = addresses_.begin(); entry != addresses_.end();) {
+		const AddressState& state = entry->second;
+		const bool full = perMicrosecond_ <= 0.0 || state.tokens + static_cast<double>(now - state.refilledAt) * perMicrosecond_ >= burst_;
+		if (state.connections == 0 && full) {
+			entry = addresses_.erase(entry);
+		} else {
+			++entry;
+		}
+	}
+	// An address flood that keeps every entry alive doesn't sweep on every attempt
+	sweepAt_ = std::max(addresses_.size() * 2, static_cast<size_t>(sweepFloor));
+}
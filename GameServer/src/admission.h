@@ -0,0 +1,169 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Admission.h
+	Purpose: Decides right after accept whether a connection may
+	become a client, before any client object or logger exists.
+	Addresses are checked against a blocklist of IPv4 prefixes and
+	against per address limits on concurrent connections and on
+	connection attempts per minute
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	/**
+		Binary trie over IPv4 prefixes. Nodes live in one
+		vector and refer to their children by index, so the
+		blocklist stays compact and a lookup walks at most
+		32 nodes without allocating
+	 */
+	class PrefixTrie {
+	public:
+		PrefixTrie();
+		/**
+			Add a prefix, host bits are ignored
+
+			@param prefix Address in host byte order
+			@param length Leading bits that count, 0 to 32
+			@return bool False if the prefix was listed already
+		 */
+		bool Insert(uint32_t prefix, int length);
+		/**
+			Remove a prefix added with Insert, prefixes
+			inside or around it stay listed
+
+			@param prefix Address in host byte order
+			@param length Leading bits that count, 0 to 32
+			@return bool False if the prefix was not listed
+		 */
+		bool Remove(uint32_t prefix, int length);
+		// True if any listed prefix covers the address
+		bool Contains(uint32_t address) const;
+		// Every listed prefix as an address and a length, in address order
+		std::vector<std::pair<uint32_t, int>> List() const;
+		size_t Size() const { return size_; };
+
+		/**
+			Read "a.b.c.d" or "a.b.c.d/n"
+
+			@param text Address or prefix
+			@param prefix Set to the address in host byte order
+			@param length Set to the prefix length, 32 without one
+			@return bool False if the text is malformed
+		 */
+		static bool Parse(const std::string& text, uint32_t& prefix, int& length);
+		static std::string Format(uint32_t prefix, int length);
+	private:
+		struct Node {
+			// Index of the child for a 0 and a 1 bit, 0 for none since the root is never a child
+			uint32_t child[2];
+			bool listed;
+		};
+
+		uint32_t Allocate();
+		void List(uint32_t node, uint32_t prefix, int depth, std::vector<std::pair<uint32_t, int>>& result) const;
+
+		std::vector<Node> nodes_;
+		// Nodes pruned by Remove, reused by Insert
+		std::vector<uint32_t> free_;
+		size_t size_;
+	};
+
+	struct AdmissionStats {
+		uint64_t admitted = 0;
+		uint64_t blocked = 0;
+		// Over the concurrent connections of the address
+		uint64_t crowded = 0;
+		// Over the connection attempts of the address
+		uint64_t flooding = 0;
+	};
+
+	class Admission {
+	public:
+		enum Verdict {
+			verdict_admit,
+			verdict_blocked,
+			verdict_crowded,
+			verdict_flooding
+		};
+
+		// Address entries are swept once there are this many
+		static constexpr size_t sweepFloor = 1024;
+
+		Admission();
+		/**
+			Set the per address limits, 0 disables either
+
+			@param max_per_address Concurrent connections of one address
+			@param per_minute Connection attempts of one address per minute
+			@param burst Attempts allowed back to back before the rate applies
+			@return void
+		 */
+		void Configure(int max_per_address, int per_minute, int burst);
+		/**
+			Check an accepted connection. Every attempt that
+			isn't blocked counts towards the rate, an admitted
+			one holds a connection of its address until the
+			socket is released
+
+			@param address Peer address in host byte order
+			@param socket Accepted socket
+			@param now Microseconds
+			@return Verdict
+		 */
+		Verdict Admit(uint32_t address, SOCKET socket, int64_t now);
+		/**
+			Give back the connection held by a socket,
+			sockets that were never admitted are ignored
+
+			@param socket Dropped socket
+			@return void
+		 */
+		void Release(SOCKET socket);
+
+		// Blocklist, safe to change while connections are admitted
+		bool Block(uint32_t prefix, int length);
+		bool Unblock(uint32_t prefix, int length);
+		std::vector<std::pair<uint32_t, int>> ListBlocked() const;
+		/**
+			Replace the blocklist with the prefixes of a file,
+			one per line, text after a # is ignored
+
+			@param path File to read
+			@return int Prefixes read, -1 if the file could not be opened
+		 */
+		int LoadBlocklist(const std::string& path);
+		bool SaveBlocklist(const std::string& path) const;
+
+		AdmissionStats GetStats() const;
+		std::string ToString() const;
+	private:
+		struct AddressState {
+			int connections = 0;
+			double tokens = 0.0;
+			int64_t refilledAt = 0;
+		};
+
+		// Forget addresses without connections whose bucket is full again
+		void Sweep(int64_t now);
+
+		int maxPerAddress_;
+		double perMicrosecond_;
+		double burst_;
+
+		PrefixTrie blocked_;
+		std::unordered_map<uint32_t, AddressState> addresses_;
+		// Address each admitted socket counts towards
+		std::unordered_map<SOCKET, uint32_t> sockets_;
+		size_t sweepAt_;
+
+		AdmissionStats stats_;
+		// Admit runs on the core thread, Release on client threads and the blocklist is changed over rcon
+		mutable std::mutex mtx_;
+	};
+
+}
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "channels.h"
+
+hgs::ChannelTable::ChannelTable(const size_t max_channels) : nextSlot_(0), maxChannels_(max_channels) {
+}
+
+int hgs::ChannelTable::AddMember() {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	if (!freeSlots_.empty()) {
+		const int slot = freeSlots_.back();
+		freeSlots_.pop_back();
+		return slot;
+	}
+	return nextSlot_++;
+}
+
+void hgs::ChannelTable::RemoveMember(const int slot) {
+	if (slot < 0) return;
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	const size_t word = static_cast<size_t>(slot) >> 6;
+	for (auto& channel : channels_) {
+		if (word < channel.members.size()) {
+			channel.members[word] &= ~(uint64_t(1) << (slot & 63));
+		}
+	}
+	freeSlots_.push_back(slot);
+}
+
+int hgs::ChannelTable::Subscribe(const std::string& name, const int slot) {
+	if (name.empty() || name.size() > maxNameLength || slot < 0) return -1;
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	size_t id = 0;
+	while (id < channels_.size() && channels_[id].name != name) {
+		id++;
+	}
+	if (id == channels_.size()) {
+		if (channels_.size() >= maxChannels_) return -1;
+		channels_.push_back({ name, {} });
+	}
+
+	std::vector<uint64_t>& members = channels_[id].members;
+	const size_t word = static_cast<size_t>(slot) >> 6;
+	if (word >= members.size()) {
+		members.resize(word + 1, 0);
+	}
+	members[word] |= uint64_t(1) << (slot & 63);
+	return static_cast<int>(id);
+}
+
+bool hgs::ChannelTable::Unsubscribe(const std::string& name, const int slot) {
+	if (slot < 0) return false;
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	for (auto& channel : channels_) {
+		if (channel.name != name) continue;
+
+		const size_t word = static_cast<size_t>(slot) >> 6;
+		const uint64_t bit = uint64_t(1) << (slot & 63);
+		if (word >= channel.members.size() || (channel.members[word] & bit) == 0) {
+			return false;
+		}
+		channel.members[word] &= ~bit;
+		return true;
+	}
+	return false;
+}
+
+int hgs::ChannelTable::Find(const std::string& name) const {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	for (size_t id = 0; id < channels_.size(); id++) {
+		if (channels_[id].name == name) {
+			return static_cast<int>(id);
+		}
+	}
+	return -1;
+}
+
+std::string hgs::ChannelTable::List() const {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	std::string result;
+	for (auto& channel : channels_) {
+		int subscribers = 0;
+		for (uint64_t word : channel.members) {
+			std::bitset<64> bits(word);
+			subscribers += static_cast<int>(bits.count());
+		}
+		result.append("\nChannel " + channel.name + " [" + std::to_string(subscribers) + "] subscribers");
+	}
+	return result;
+}
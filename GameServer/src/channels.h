@@ -0,0 +1,91 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Channels.h
+	Purpose: Subscription channels inside a lobby. Every client holds
+	a slot in the lobby and every channel a bitset over the slots, so
+	routing a tagged frame is a single bit test per recipient
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// Frames tagged with a channel start with a header: "{id|@c=name@payload}"
+	constexpr char channelHeader[] = "@c=";
+
+	/**
+		Subscriptions change in the receive phase, from the
+		client threads, and are read in the send phase. Writes
+		are serialized, reads go without a lock
+	 */
+	class ChannelTable {
+	public:
+		static constexpr size_t maxNameLength = 32;
+
+		explicit ChannelTable(size_t max_channels);
+		/**
+			Give a client joining the lobby a slot,
+			slots of clients that left are reused
+
+			@return int The slot
+		 */
+		int AddMember();
+		/**
+			Free a slot and drop it from every channel
+
+			@param slot Slot from AddMember
+			@return void
+		 */
+		void RemoveMember(int slot);
+		/**
+			Subscribe a slot, the channel is created
+			on the first subscription
+
+			@param name Channel name
+			@param slot Subscribing slot
+			@return int Channel id, -1 if the lobby has no room for
+			another channel or the name is invalid
+		 */
+		int Subscribe(const std::string& name, int slot);
+		/**
+			@param name Channel name
+			@param slot Unsubscribing slot
+			@return bool False if the slot was not subscribed
+		 */
+		bool Unsubscribe(const std::string& name, int slot);
+		/**
+			@param name Channel name
+			@return int Channel id, -1 if nobody ever subscribed to it
+		 */
+		int Find(const std::string& name) const;
+
+		bool IsSubscribed(const int channel, const int slot) const {
+			const std::vector<uint64_t>& members = channels_[static_cast<size_t>(channel)].members;
+			const size_t word = static_cast<size_t>(slot) >> 6;
+			return word < members.size() && (members[word] >> (slot & 63) & 1) != 0;
+		};
+		/**
+			Compose a listing of every channel
+			and its subscriber count
+
+			@return std::string
+		 */
+		std::string List() const;
+	private:
+		struct Channel {
+			std::string name;
+			std::vector<uint64_t> members;
+		};
+
+		std::vector<Channel> channels_;
+		std::vector<int> freeSlots_;
+		int nextSlot_;
+		const size_t maxChannels_;
+
+		mutable std::mutex channelMtx_;
+	};
+
+}
@@ -1,9 +1,14 @@
 #include "pch.h"
 #include "client.h"
 #include "utilities.h"
+#include "trace.h"
 
 hgs::Client::Client(const SOCKET socket, const gsl::not_null<SharedMemory*> shared_memory, const int id, const int lobby_id) :
-socket_(socket), comRegex_("[^\\|{}\\[\\]]+"), sharedMemory_(shared_memory), lobbyId(lobby_id), id(id) {
+Client(std::make_unique<SocketTransport>(socket), shared_memory, id, lobby_id) {
+}
+
+hgs::Client::Client(std::unique_ptr<Transport> transport, const gsl::not_null<SharedMemory*> shared_memory, const int id, const int lobby_id) :
+socket_(transport->GetHandle()), transport_(std::move(transport)), comRegex_("[^\\|{}\\[\\]]+"), sharedMemory_(shared_memory), lobbyId(lobby_id), id(id) {
 
 	isOnline_ = true;
 	state_ = none;
@@ -13,12 +18,47 @@ socket_(socket), comRegex_("[^\\|{}\\[\\]]+"), sharedMemory_(shared_memory), lob
 	//upStreamCall_ = nullptr;
 
 	loopInterval_ = std::chrono::microseconds(1000);
+	clock_ = &sharedMemory_->GetClock();
+
+	channel_ = -1;
+	stateFrame_ = false;
+	slot_ = -1;
+	moved_ = false;
+
+	sampleRate_ = sharedMemory_->GetConfigurations().latencySampleRate;
+	sampleCounter_ = 0;
+
+	pingSequence_ = 0;
+	lastPingAt_ = 0;
+	pingInterval_ = static_cast<int64_t>(sharedMemory_->GetConfigurations().pingInterval) * 1000;
+	pingTimeout_ = static_cast<int64_t>(sharedMemory_->GetConfigurations().pingTimeout) * 1000;
+
+	deltaEnabled_ = false;
+	compressing_ = false;
+	keyframeInterval_ = sharedMemory_->GetConfigurations().deltaKeyframeInterval;
+
+	resumeGrace_ = static_cast<int64_t>(sharedMemory_->GetConfigurations().resumeGrace) * 1000;
+	resumeBufferTicks_ = static_cast<size_t>(std::max(sharedMemory_->GetConfigurations().resumeBufferTicks, 0));
+	suspended_ = false;
+	suspendedAt_ = 0;
+	unreliable_ = false;
+	sendDatagrams_ = false;
+	reliableEnabled_ = false;
+	handedOver_ = false;
+	skippingPartial_ = false;
+
+	const Configuration& conf = sharedMemory_->GetConfigurations();
+	if (conf.decimationEnable) {
+		rate_.Configure(conf.decimationMaxInterval, static_cast<int64_t>(conf.clockSpeed) * 1000, static_cast<int64_t>(conf.decimationRtt) * 1000);
+	}
+	ingress_.Configure(static_cast<size_t>(std::max(conf.ingressMaxFrame, 0)), conf.ingressMessagesPerSecond, conf.ingressBytesPerSecond,
+		conf.ingressThrottleAfter, conf.ingressKickAfter);
 
 	// Setup client logger
 	std::vector<spdlog::sink_ptr> sinks;
 	sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
 	sinks.push_back(sharedMemory_->GetFileSink());
-	log_ = std::make_shared<spdlog::logger>("Client#" + std::to_string(socket), begin(sinks), end(sinks));
+	log_ = std::make_shared<spdlog::logger>("Client#" + std::to_string(socket_), begin(sinks), end(sinks));
 	log_->set_pattern("[%a %b %d %H:%M:%S %Y] [%L] %^%n: %v%$");
 	register_logger(log_);
 
@@ -27,36 +67,29 @@ socket_(socket), comRegex_("[^\\|{}\\[\\]]+"), sharedMemory_(shared_memory), lob
 hgs::Client::~Client() {
 	isOnline_ = false;
 	log_->info("Dropped");
-	spdlog::drop("Client#" + std::to_string(socket_));
-	sharedMemory_->DropSocket(socket_);
+	spdlog::drop(log_->name());
+	sharedMemory_->GetUdp().Forget(id);
+	// Wait out a resume that might be handing this client a connection
+	sharedMemory_->DropSuspended(id);
+	// A handed over connection lives on in the resumed client
+	if (transport_ != nullptr) {
+		sharedMemory_->DropSocket(socket_);
+		transport_->Close();
+	}
 }
 
 void hgs::Client::Loop() {
+	trace::SetThreadName("Client#" + std::to_string(id));
+
 	while (isOnline_) {
-		// Listen for calls from core
-		CoreCallListener();
-
-		// Don't send and receive in transition states between lobbies
-		if (lobbyMemory_ != nullptr) {
-			// Perform send operation if serverApp is ready and
-			// the client has not already performed it
-			if (lobbyMemory_->GetState() == sending &&
-				lastState_ != sending) {
-				Send();
-			}
-			// Perform receiving operation if serverApp is ready and
-			// the client has not already performed it
-			else if (lobbyMemory_->GetState() == receiving &&
-				lastState_ != receiving) {
-				Receive();
-			}
-			std::this_thread::sleep_for(loopInterval_);
+		if (Step()) {
+			clock_->Sleep(loopInterval_);
 		}
 	}
 
 	if (attached_) {
 		// Add self to dropList in lobby
-		lobbyMemory_->AddDrop(this->id);
+		RequestDrop();
 
 		while (attached_) {
 			std::this_thread::sleep_for(std::chrono::milliseconds(250));
@@ -66,45 +99,167 @@ void hgs::Client::Loop() {
 	delete this;
 }
 
+bool hgs::Client::Step() {
+	// Listen for calls from core
+	CoreCallListener();
+
+	if (suspended_) {
+		TakeOver();
+	}
+	if (reliableEnabled_) {
+		PumpReliable();
+	}
+
+	// Release held back messages of impaired links
+	transport_->Pump();
+
+	// Don't send and receive in transition states between lobbies
+	if (lobbyMemory_ == nullptr) {
+		return false;
+	}
+
+	// Perform send operation if serverApp is ready and
+	// the client has not already performed it
+	if (lobbyMemory_->GetState() == sending &&
+		lastState_ != sending) {
+		Send();
+	}
+	// Perform receiving operation if serverApp is ready and
+	// the client has not already performed it
+	else if (lobbyMemory_->GetState() == receiving &&
+		lastState_ != receiving &&
+		(suspended_ || (reliableEnabled_ && reliable_.HasMessages()) || transport_->Ready() || IsUdpBound())) {
+		Receive();
+	}
+	return true;
+}
+
+void hgs::Client::RequestDrop() {
+	lobbyMemory_->AddDrop(this->id);
+}
+
 void hgs::Client::Receive() {
+	HGS_TRACE_SCOPE("Client::Receive", id);
 
 	state_ = receiving;
 
+	received_.clear();
+	moved_ = false;
+	unreliable_ = false;
+
+	// Nothing arrives while the connection is gone, the lobby gets an empty response
+	if (suspended_) {
+		if (clock_->Now() - suspendedAt_ >= resumeGrace_) {
+			Expire("grace period ended");
+		}
+		lastState_ = receiving;
+		state_ = received;
+		return;
+	}
+
+	// Throttled clients are not read from, what they send waits in the socket buffer
+	if (ingress_.IsThrottled(clock_->Now())) {
+		lastState_ = receiving;
+		state_ = received;
+		return;
+	}
+
+	// Messages of the reliable channel count as messages on the TCP connection
+	if (reliableEnabled_ && reliable_.HasMessages()) {
+		std::string message;
+		while (reliable_.Receive(message)) {
+			// TCP messages end at a NUL, one inside would split the frame for recipients
+			if (message.empty() || message.find('\0') != std::string::npos) continue;
+			const IngressLimiter::Verdict verdict = Admit(message.size());
+			if (verdict == IngressLimiter::verdict_admit) {
+				TakeMessage(message, 0, false);
+			}
+			else if (verdict != IngressLimiter::verdict_drop) break;
+		}
+		lastState_ = receiving;
+		state_ = received;
+		return;
+	}
+
+	// Bound clients never hold up the tick, without anything on the TCP
+	// connection they answer with the newest state frame sent over UDP
+	if (!transport_->Ready() && IsUdpBound()) {
+		// API calls are never sent as state
+		std::string datagram;
+		if (sharedMemory_->GetUdp().Take(id, datagram) && !datagram.empty() && !IsApiCall(datagram) &&
+			Admit(datagram.size()) == IngressLimiter::verdict_admit) {
+			unreliable_ = true;
+			TakeMessage(datagram, 0, false);
+		}
+		lastState_ = receiving;
+		state_ = received;
+		return;
+	}
+
 	char incoming[1024];
 
 	// Clear the storage before usage
 	ZeroMemory(incoming, 1024);
 
 	// Receive 
-	const int bytes = recv(socket_, incoming, 1024, 0);
+	const int bytes = transport_->Receive(incoming, 1024);
+
+	// Arrival time, only kept if the message ends up sampled
+	const int64_t receivedAt = (sampleRate_ > 0 ? clock_->Now() : 0);
 
-	// Check if client responds
+	// Check if client responds, only a lost connection may come back,
+	// a client that closed it is gone for good
 	if (bytes <= 0) {
-		// Disconnect client
-		isOnline_ = false;
-		log_->warn("Lost connection to client");
-		// Tell other clients that this client has disconnected
-		clientCommand_ = "{" + std::to_string(id) + "|D}";
+		if (bytes < 0 && Suspend()) {
+			lastState_ = receiving;
+			state_ = received;
+			return;
+		}
+		Disconnect("Lost connection to client");
 		lastState_ = receiving;
 		state_ = received;
 		return;
 	}
 
-	clientCommand_ = std::string(incoming, strlen(incoming));
+	// One read may hold several NUL terminated messages, every one of them is taken.
+	// The limits only look at the length, rejected messages are never copied
+	const char* end = incoming + bytes;
+	for (const char* start = incoming; start < end;) {
+		const char* terminator = std::find(start, end, '\0');
 
-	// Only encapsulate if there is any content
-	if (bytes > 1) {
-		if (IsApiCall(clientCommand_)) {
-			PerformApiCall(clientCommand_);
-			clientCommand_.clear();
-		} else {
-			// Encapsulate command inside a socket block
-			clientCommand_.insert(0, "{" + std::to_string(id) + "|");
-			clientCommand_.append("}");	
+		// A message cut by the read waits for the rest of it
+		if (terminator == end) {
+			if (!skippingPartial_) {
+				KeepPartial(start, end);
+			}
+			break;
+		}
+		if (skippingPartial_) {
+			skippingPartial_ = false;
+			start = terminator + 1;
+			continue;
+		}
+
+		const size_t length = partial_.size() + static_cast<size_t>(terminator - start);
+		if (length > 0) {
+			const IngressLimiter::Verdict verdict = Admit(length);
+			if (verdict == IngressLimiter::verdict_admit) {
+				std::string message;
+				message.swap(partial_);
+				message.append(start, terminator);
+				TakeMessage(message, receivedAt, sampleRate_ > 0);
+			}
+			// The rest of the read goes with a throttled or kicked client,
+			// a message it cut off is skipped up to its NUL in a later read
+			else if (verdict != IngressLimiter::verdict_drop) {
+				partial_.clear();
+				skippingPartial_ = *(end - 1) != '\0';
+				break;
+			}
 		}
+		partial_.clear();
+		start = terminator + 1;
 	}
-	else 
-		clientCommand_.clear();
 
 	lastState_ = receiving;
 
@@ -113,25 +268,253 @@ void hgs::Client::Receive() {
 
 }
 
+void hgs::Client::TakeMessage(std::string& message, const int64_t received_at, const bool sample) {
+	// Only encapsulate if there is any content
+	if (message.empty()) return;
+	if (IsApiCall(message)) {
+		PerformApiCall(message);
+		return;
+	}
+
+	clientCommand_.swap(message);
+	stamps_ = nullptr;
+	channel_ = -1;
+	stateFrame_ = false;
+	targets_.clear();
+	PrepareFrame(received_at, sample);
+	if (clientCommand_.empty()) return;
+
+	Message frame;
+	frame.sender = id;
+	frame.frame = std::move(clientCommand_);
+	frame.stamps = stamps_;
+	frame.channel = channel_;
+	frame.slot = slot_;
+	frame.targets = targets_;
+	frame.unreliable = unreliable_;
+	frame.state = stateFrame_;
+	received_.push_back(std::move(frame));
+	clientCommand_.clear();
+}
+
+void hgs::Client::KeepPartial(const char* start, const char* end) {
+	partial_.append(start, end);
+
+	const size_t limit = ingress_.GetMaxFrame() > 0 ? ingress_.GetMaxFrame() : maxPartial;
+	if (partial_.size() <= limit) return;
+
+	// Counted once as oversized, whatever is left of it never reaches the limits
+	if (ingress_.GetMaxFrame() > 0) {
+		Admit(partial_.size());
+	}
+	log_->warn("Dropped a message over " + std::to_string(limit) + " bytes");
+	partial_.clear();
+	skippingPartial_ = true;
+}
+
+hgs::IngressLimiter::Verdict hgs::Client::Admit(const size_t bytes) {
+	if (!ingress_.IsEnabled()) return IngressLimiter::verdict_admit;
+
+	const int64_t now = clock_->Now();
+	const bool throttled = ingress_.IsThrottled(now);
+	const IngressLimiter::Verdict verdict = ingress_.Admit(bytes, now);
+	if (verdict == IngressLimiter::verdict_throttle && !throttled) {
+		log_->warn("Throttled for exceeding the ingress limits");
+	}
+	else if (verdict == IngressLimiter::verdict_kick) {
+		Disconnect("Kicked for exceeding the ingress limits");
+	}
+	return verdict;
+}
+
+void hgs::Client::Disconnect(const std::string& reason) {
+	isOnline_ = false;
+	log_->warn(reason);
+	// Tell other clients that this client has disconnected
+	Message disconnect;
+	disconnect.sender = id;
+	disconnect.frame = "{" + std::to_string(id) + "|D}";
+	// Without a slot the frame is global, every client hears of the leave
+	received_.push_back(disconnect);
+}
+
+void hgs::Client::PrepareFrame(const int64_t received_at, const bool sample) {
+	// Headers stay in the frame so recipients see the position, the channel and the targets
+	const size_t channelAt = ReadPosition(clientCommand_, position_);
+	moved_ = moved_ || channelAt > 0;
+
+	size_t targetAt = channelAt;
+	if (clientCommand_.compare(channelAt, 3, channelHeader) == 0) {
+		const size_t end = clientCommand_.find('@', channelAt + 3);
+		if (end != std::string::npos) {
+			channel_ = lobbyMemory_->GetParent()->GetChannels().Find(clientCommand_.substr(channelAt + 3, end - channelAt - 3));
+			targetAt = end + 1;
+		}
+		// Nobody ever subscribed, the frame has no recipients
+		if (channel_ < 0) {
+			clientCommand_.clear();
+			return;
+		}
+	}
+
+	// Only marked frames are state, anything else may be an event and all of them arrive
+	if (clientCommand_.compare(targetAt, 3, stateHeader) == 0) {
+		stateFrame_ = true;
+		targetAt += 3;
+	}
+
+	// A malformed target list has no recipients either
+	if (clientCommand_.compare(targetAt, 3, targetHeader) == 0 &&
+		utilities::ReadTargets(clientCommand_, targetAt, targets_) == 0) {
+		pendingSend_.append("{#|Invalid targets}");
+		clientCommand_.clear();
+		return;
+	}
+
+	// Encapsulate command inside a socket block
+	clientCommand_.insert(0, "{" + std::to_string(id) + "|");
+	clientCommand_.append("}");
+
+	if (sample && ++sampleCounter_ >= sampleRate_) {
+		sampleCounter_ = 0;
+		stamps_ = std::make_shared<LatencyStamps>();
+		stamps_->at[stage_recv] = received_at;
+		stamps_->at[stage_decode] = clock_->Now();
+	}
+}
+
 void hgs::Client::Send() {
+	HGS_TRACE_SCOPE("Client::Send", id);
+
 	state_ = sending;
 
-	// Append potential command from core
-	std::string outgoing = pendingSend_;
+	// Clients on slow links skip ticks, what they would have got is merged until their next send
+	if (rate_.IsEnabled() && !suspended_ && !rate_.Tick()) {
+		SelectFrames();
+		for (size_t index : selected_) {
+			Hold(outgoingCommands_[index]);
+		}
+		if (reliableEnabled_) {
+			PumpReliable();
+		}
+		lastState_ = sending;
+		state_ = sent;
+		return;
+	}
+
+	// Append potential command from core, replies and core calls take
+	// the reliable channel once the client asked for it
+	std::string outgoing;
+	const bool reliable = reliableEnabled_ && !suspended_;
+	if (!reliable) {
+		outgoing = pendingSend_;
+	} else if (!pendingSend_.empty()) {
+		reliable_.Send(stream_control, pendingSend_);
+	}
+
+	// Probe the link, the client answers with "#pong|<sequence>"
+	if (pingInterval_ > 0 && !suspended_) {
+		const int64_t now = clock_->Now();
+		if (now - lastPingAt_ >= pingInterval_) {
+			lastPingAt_ = now;
+			pingSequence_++;
+			outgoing.append("{0|I" + std::to_string(pingSequence_) + "}");
+			link_.OnPing(pingSequence_, now, pingTimeout_);
+		}
+	}
+
+	// Catch up on the lobby before its current tick
+	if (!snapshot_.empty()) {
+		outgoing.append(snapshot_);
+		snapshot_.clear();
+	}
+
+	// Offsets of the build stamps of sampled messages, the send stamp follows each,
+	// with the pickup time of the message for the histogram
+	std::vector<std::pair<size_t, int64_t>> stampAt;
+
+	// State frames that came in over UDP leave the same way to bound clients
+	datagrams_.clear();
+	sendDatagrams_ = !suspended_ && IsUdpBound();
+
+	const bool delta = deltaEnabled_;
+	if (delta) {
+		delta_.Begin(keyframeInterval_);
+	}
+
+	SelectFrames();
+	if (held_.empty()) {
+		for (size_t index : selected_) {
+			AppendMessage(outgoing, outgoingCommands_[index], delta, stampAt);
+		}
+	} else {
+		// Merged with the skipped ticks, the compressed frames of the lobby only cover this one
+		compressed_ = nullptr;
+		for (size_t index : selected_) {
+			Hold(outgoingCommands_[index]);
+		}
+		for (const Message& message : held_) {
+			AppendMessage(outgoing, message, delta, stampAt);
+		}
+		held_.clear();
+		heldIndex_.clear();
+	}
 
-	// Iterate through all clients
-	auto queue = outgoingCommands_;
+	// The send stamp in the payload can only mark the hand-off to the
+	// transport, the histogram gets the time the send itself took
+	int64_t builtAt = 0;
+	if (!stampAt.empty()) {
+		builtAt = clock_->Now();
+		for (const auto& stamp : stampAt) {
+			utilities::WriteStamp(&outgoing[stamp.first], builtAt);
+			utilities::WriteStamp(&outgoing[stamp.first + stampDigits + 1], builtAt);
+		}
+	}
+	int64_t sentAt = 0;
+	bool sent = false;
 
-	for (auto& client : queue) {
-		// Skip command if it comes from the client itself
-		if (Split(client)[0] == std::to_string(id)) { continue; }
+	// The compressed frames go last, everything before the marker is plain text
+	if (compressed_ != nullptr) {
+		outgoing.append(*compressed_);
+	}
 
-		outgoing.append(client);
+	// Send payload, or keep it for the resumed connection
+	if (suspended_) {
+		missed_.push_back(outgoing);
+		// Dropping a payload would break the delta baselines, the session ends instead
+		if (missed_.size() > resumeBufferTicks_) {
+			Expire("missed more than " + std::to_string(resumeBufferTicks_) + " ticks");
+		}
+	} else {
+		const bool timed = rate_.IsEnabled() || !stampAt.empty();
+		const int64_t sendingAt = (timed ? clock_->Now() : 0);
+		transport_->Send(outgoing.c_str(), static_cast<int>(outgoing.size()) + 1);
+		if (timed) {
+			sentAt = clock_->Now();
+		}
+		sent = true;
+		if (rate_.IsEnabled()) {
+			rate_.OnSent(outgoing.size(), sentAt - sendingAt, link_.GetStats());
+		}
+		if (!datagrams_.empty()) {
+			sharedMemory_->GetUdp().Send(id, datagrams_);
+		}
+		if (reliable) {
+			PumpReliable();
+		}
 	}
 
-	// Send payload
-	// TODO encode output using compressor tool
-	send(socket_, outgoing.c_str(), static_cast<int>(outgoing.size()) + 1, 0);
+	// Only the stamped frames that went into this payload are measured
+	if (!stampAt.empty()) {
+		LatencyHistogram& latency = sharedMemory_->GetLatency();
+		for (const auto& stamp : stampAt) {
+			latency.Add(stage_build, builtAt - stamp.second);
+			// Payloads kept for a resumed connection were never sent
+			if (sent) {
+				latency.Add(stage_send, sentAt - builtAt);
+			}
+		}
+	}
 
 	// Client ready
 	lastState_ = sending;
@@ -141,6 +524,116 @@ void hgs::Client::Send() {
 	pendingSend_.clear();
 }
 
+void hgs::Client::SelectFrames() {
+	selected_.clear();
+
+	const InterestGrid* interest = (lobbyMemory_ != nullptr ? lobbyMemory_->GetParent()->GetInterest() : nullptr);
+	if (interest != nullptr && interest->IsPlaced(slot_)) {
+		// Global frames and the frames of senders within the interest radius
+		for (size_t index : interest->GetGlobal()) {
+			if (index < outgoingCommands_.size()) {
+				selected_.push_back(index);
+			}
+		}
+		interest->Query(slot_, nearby_);
+		for (int slot : nearby_) {
+			for (int index = interest->GetFrame(slot); index >= 0; index = interest->GetNext(index)) {
+				if (static_cast<size_t>(index) < outgoingCommands_.size()) {
+					selected_.push_back(static_cast<size_t>(index));
+				}
+			}
+		}
+	} else {
+		// Iterate through all clients
+		for (size_t index = 0; index < outgoingCommands_.size(); index++) {
+			selected_.push_back(index);
+		}
+	}
+}
+
+bool hgs::Client::IsRecipient(const Message& message) const {
+	// Skip command if it comes from the client itself
+	if (message.sender == id) { return false; }
+
+	// Channel frames only go to subscribers
+	if (message.channel >= 0) {
+		if (lobbyMemory_ == nullptr || !lobbyMemory_->GetParent()->GetChannels().IsSubscribed(message.channel, slot_)) {
+			return false;
+		}
+	}
+
+	// Addressed frames only go to their targets
+	return message.targets.empty() || std::find(message.targets.begin(), message.targets.end(), id) != message.targets.end();
+}
+
+void hgs::Client::Hold(const Message& message) {
+	if (!IsRecipient(message)) return;
+
+	// Events all arrive, frames marked as state only in their newest version
+	if (message.state && message.targets.empty()) {
+		const uint64_t key = static_cast<uint64_t>(static_cast<uint32_t>(message.sender)) << 32 | static_cast<uint32_t>(message.channel + 1);
+		const auto held = heldIndex_.find(key);
+		if (held != heldIndex_.end()) {
+			held_[held->second] = message;
+			return;
+		}
+		heldIndex_[key] = held_.size();
+	}
+	held_.push_back(message);
+}
+
+void hgs::Client::AppendMessage(std::string& outgoing, const Message& message, const bool delta, std::vector<std::pair<size_t, int64_t>>& stamp_at) {
+	if (!IsRecipient(message)) { return; }
+
+	// Sent plain since datagrams may be lost, they never touch the delta baselines
+	if (message.unreliable && sendDatagrams_) {
+		datagrams_.append(message.frame);
+		return;
+	}
+
+	if (message.stamps == nullptr) {
+		// Already part of the compressed frames
+		if (compressed_ != nullptr && message.IsShared()) {
+			return;
+		}
+		if (delta) {
+			delta_.Append(outgoing, message);
+		} else {
+			outgoing.append(message.frame);
+		}
+	} else {
+		// Sampled frames go out complete and become the baseline
+		stamp_at.emplace_back(AppendStamped(outgoing, message), message.stamps->at[stage_pickup]);
+		if (delta) {
+			delta_.Store(message);
+		}
+	}
+}
+
+size_t hgs::Client::AppendStamped(std::string& outgoing, const Message& message) const {
+	// Header goes right after "{id|"
+	const size_t payloadAt = message.frame.find('|') + 1;
+	outgoing.append(message.frame, 0, payloadAt);
+	outgoing.append("@l=");
+
+	for (int stage = stage_recv; stage <= stage_pickup; stage++) {
+		const size_t at = outgoing.size();
+		outgoing.append(stampDigits, '0');
+		utilities::WriteStamp(&outgoing[at], message.stamps->at[stage]);
+		outgoing.push_back(',');
+	}
+
+	// Placeholders for the build and send stamps
+	const size_t buildAt = outgoing.size();
+	outgoing.append(stampDigits, '0');
+	outgoing.push_back(',');
+	outgoing.append(stampDigits, '0');
+	outgoing.push_back('@');
+
+	outgoing.append(message.frame, payloadAt, std::string::npos);
+	return buildAt;
+}
+
 void hgs::Client::CoreCallListener() {
 
 	// Get core call
@@ -219,51 +712,245 @@ void hgs::Client::DropLobbyConnections() {
 
 	lobbyId = -1;
 	lobbyMemory_ = nullptr;
+
+	// Baselines belong to the old lobby, the client drops them on {*|D}
+	delta_.Reset();
+	held_.clear();
+	heldIndex_.clear();
 }
 
-bool hgs::Client::IsApiCall(std::string& string) {
-	for (char character : string) {
-		if (character == '#') return true;
+bool hgs::Client::Resume(const std::string& token, std::unique_ptr<Transport>& transport) {
+	std::lock_guard<std::mutex> lock(resumeMtx_);
+	if (!suspended_ || handover_ != nullptr || sessionToken_.empty() || token != sessionToken_) {
+		return false;
 	}
-	return false;
+	handover_ = std::move(transport);
+	return true;
 }
-void hgs::Client::PerformApiCall(std::string& call) {
-	std::vector<std::string> segment = Split(call);
 
-	// TODO add password support
-	if (segment[0] == "#join" && segment.size() >= 2) {
-		Lobby* target = nullptr;
+bool hgs::Client::Suspend() {
+	if (sessionToken_.empty() || resumeGrace_ <= 0 || lobbyMemory_ == nullptr) {
+		return false;
+	}
 
-		if (utilities::IsInt(segment[1])) {
-			target = sharedMemory_->FindLobby(std::stoi(segment[1]));
-		} else {
-			target = sharedMemory_->FindLobby(segment[1]);
-		}
+	{
+		std::lock_guard<std::mutex> lock(resumeMtx_);
+		suspended_ = true;
+		suspendedAt_ = clock_->Now();
+	}
+	// Reachable for #resume only once suspended, Resume checks the flag
+	sharedMemory_->AddSuspended(this);
+	log_->warn("Lost connection to client, holding the session for " + std::to_string(resumeGrace_ / 1000) + " ms");
+	return true;
+}
 
-		if (target == nullptr) {
-			pendingSend_.append("{#|Lobby does not exist}");
-			log_->warn("Client#" + std::to_string(id) + " tried to move to unknown lobby");
-			return;
-		} 
-		if (target == lobbyMemory_->GetParent()) {
-			pendingSend_.append("{#|Client is already located in targeted lobby}");
-			return;
-		}
+void hgs::Client::TakeOver() {
+	std::lock_guard<std::mutex> lock(resumeMtx_);
+	if (handover_ == nullptr) return;
 
-		const std::string result = sharedMemory_->MoveClient(lobbyMemory_->GetParent(), target, this).second;
-		pendingSend_.append("{#|" + result + "}");
+	sharedMemory_->DropSocket(socket_);
+	transport_->Close();
+	transport_ = std::move(handover_);
+	socket_ = transport_->GetHandle();
+	suspended_ = false;
+	// A message cut off by the lost connection never completes
+	partial_.clear();
+	skippingPartial_ = false;
+
+	// The replayed payloads follow each other, so delta baselines stay valid
+	for (auto& payload : missed_) {
+		transport_->Send(payload.c_str(), static_cast<int>(payload.size()) + 1);
 	}
-	else if (segment[0] == "#leave") {
-		if (lobbyMemory_->GetParent() == sharedMemory_->GetMainLobby()) {
-			pendingSend_.append("{#|Client is already located in main}");
-			return;
+	log_->info("Resumed session after " + std::to_string(missed_.size()) + " missed ticks");
+	missed_.clear();
+
+	pendingSend_.append("{#|Resumed " + std::to_string(id) + "}");
+}
+
+void hgs::Client::Expire(const std::string& reason) {
+	std::lock_guard<std::mutex> lock(resumeMtx_);
+	// A connection is already waiting, it is taken over on the next iteration
+	if (handover_ != nullptr) return;
+
+	suspended_ = false;
+	isOnline_ = false;
+	missed_.clear();
+	log_->warn("Session expired, " + reason);
+}
+
+// Looked up by the first segment of a control frame, the name includes the #
+const hgs::Client::ApiCommand hgs::Client::apiCommands_[] = {
+	{ "#join", 2, &Client::ApiJoin },
+	{ "#leave", 1, &Client::ApiLeave },
+	{ "#pong", 2, &Client::ApiPong },
+	{ "#sub", 2, &Client::ApiSubscribe },
+	{ "#unsub", 2, &Client::ApiUnsubscribe },
+	{ "#set", 1, &Client::ApiStore },
+	{ "#inc", 1, &Client::ApiStore },
+	{ "#cas", 1, &Client::ApiStore },
+	{ "#resume", 3, &Client::ApiResume },
+	{ "#reliable", 1, &Client::ApiReliable },
+	{ "#delta", 1, &Client::ApiDelta },
+	{ "#compress", 1, &Client::ApiCompress }
+};
+
+bool hgs::Client::IsApiCall(const std::string& string) {
+	// Only the frame type byte is looked at, data frames may carry # anywhere else
+	return !string.empty() && string[0] == apiMarker;
+}
+
+void hgs::Client::PerformApiCall(std::string& call) {
+	const std::vector<std::string> segment = Split(call);
+
+	if (!segment.empty()) {
+		for (const ApiCommand& command : apiCommands_) {
+			if (segment[0] == command.name && segment.size() >= command.segments) {
+				(this->*command.perform)(segment);
+				return;
+			}
 		}
-		const std::string result = sharedMemory_->MoveClient(lobbyMemory_->GetParent(), nullptr, this).second;
-		pendingSend_.append(result);
 	}
-	else {
-		log_->warn("Client command not performed");
+	log_->warn("Client command not performed");
+}
+
+void hgs::Client::ApiJoin(const std::vector<std::string>& segment) {
+	Lobby* target = nullptr;
+
+	if (utilities::IsInt(segment[1])) {
+		target = sharedMemory_->FindLobby(std::stoi(segment[1]));
+	} else {
+		target = sharedMemory_->FindLobby(segment[1]);
 	}
+
+	if (target == nullptr) {
+		pendingSend_.append("{#|Lobby does not exist}");
+		log_->warn("Client#" + std::to_string(id) + " tried to move to unknown lobby");
+		return;
+	} 
+	if (target == lobbyMemory_->GetParent()) {
+		pendingSend_.append("{#|Client is already located in targeted lobby}");
+		return;
+	}
+
+	const std::string result = sharedMemory_->MoveClient(lobbyMemory_->GetParent(), target, this).second;
+	pendingSend_.append("{#|" + result + "}");
+}
+
+void hgs::Client::ApiLeave(const std::vector<std::string>& segment) {
+	if (lobbyMemory_->GetParent() == sharedMemory_->GetMainLobby()) {
+		pendingSend_.append("{#|Client is already located in main}");
+		return;
+	}
+	const std::string result = sharedMemory_->MoveClient(lobbyMemory_->GetParent(), nullptr, this).second;
+	pendingSend_.append(result);
+}
+
+void hgs::Client::ApiPong(const std::vector<std::string>& segment) {
+	if (!utilities::IsInt(segment[1]) ||
+		!link_.OnPong(static_cast<uint32_t>(std::stoul(segment[1])), clock_->Now())) {
+		log_->warn("Client#" + std::to_string(id) + " answered an unknown ping");
+	}
+}
+
+void hgs::Client::ApiSubscribe(const std::vector<std::string>& segment) {
+	const std::string& name = segment[1];
+	if (name.empty() || name.size() > ChannelTable::maxNameLength || name.find('@') != std::string::npos) {
+		pendingSend_.append("{#|Invalid channel name}");
+		return;
+	}
+	if (lobbyMemory_->GetParent()->GetChannels().Subscribe(name, slot_) < 0) {
+		pendingSend_.append("{#|Channel limit reached}");
+		return;
+	}
+	pendingSend_.append("{#|Subscribed " + name + "}");
+}
+
+void hgs::Client::ApiUnsubscribe(const std::vector<std::string>& segment) {
+	const std::string& name = segment[1];
+	if (!lobbyMemory_->GetParent()->GetChannels().Unsubscribe(name, slot_)) {
+		pendingSend_.append("{#|Not subscribed to " + name + "}");
+		return;
+	}
+	pendingSend_.append("{#|Unsubscribed " + name + "}");
+}
+
+void hgs::Client::ApiStore(const std::vector<std::string>& segment) {
+	if (sharedMemory_->GetConfigurations().storeMaxKeys <= 0) {
+		pendingSend_.append("{#|Store is disabled}");
+		return;
+	}
+	StoreMutation mutation;
+	if (!StoreMutation::Parse(segment, mutation)) {
+		pendingSend_.append("{#|Invalid store call}");
+		return;
+	}
+	mutations_.push_back(mutation);
+}
+
+void hgs::Client::ApiResume(const std::vector<std::string>& segment) {
+	// Only ever looked up and handed the connection under the shared memory's lock,
+	// the suspended client may expire and be deleted on its own thread at any time
+	const int suspendedId = utilities::IsInt(segment[1]) ? std::stoi(segment[1]) : -1;
+	if (suspendedId < 0 || suspendedId == id || !sharedMemory_->ResumeClient(suspendedId, segment[2], transport_)) {
+		pendingSend_.append("{#|Session not found}");
+		return;
+	}
+	// The connection belongs to the resumed client now, this one leaves quietly
+	log_->info("Handed connection to Client#" + std::to_string(suspendedId));
+	handedOver_ = true;
+	isOnline_ = false;
+}
+
+void hgs::Client::ApiReliable(const std::vector<std::string>& segment) {
+	if (!IsUdpBound()) {
+		pendingSend_.append("{#|Udp address not bound}");
+		return;
+	}
+	// The reply already takes the new path
+	reliableEnabled_ = segment.size() < 2 || segment[1] != "off";
+	pendingSend_.append(reliableEnabled_ ? "{#|Reliable udp on}" : "{#|Reliable udp off}");
+}
+
+void hgs::Client::ApiDelta(const std::vector<std::string>& segment) {
+	if (!sharedMemory_->GetConfigurations().deltaEnable) {
+		pendingSend_.append("{#|Delta encoding is disabled}");
+		return;
+	}
+	const bool enable = segment.size() < 2 || segment[1] != "off";
+	if (enable && !deltaEnabled_) {
+		delta_.Reset();
+	}
+	deltaEnabled_ = enable;
+	if (enable) {
+		compressing_ = false;
+	}
+	pendingSend_.append(enable ? "{#|Delta encoding on}" : "{#|Delta encoding off}");
+}
+
+void hgs::Client::ApiCompress(const std::vector<std::string>& segment) {
+	if (!sharedMemory_->GetConfigurations().compressionEnable) {
+		pendingSend_.append("{#|Compression is disabled}");
+		return;
+	}
+	if (segment.size() >= 2 && segment[1] == "off") {
+		compressing_ = false;
+		pendingSend_.append("{#|Compression off}");
+		return;
+	}
+
+	// The client proves it holds the same dictionary
+	const uint32_t dictionary = sharedMemory_->GetCompressor().GetId();
+	char* end = nullptr;
+	const unsigned long offered = (segment.size() >= 2 ? std::strtoul(segment[1].c_str(), &end, 10) : 0);
+	if (segment.size() < 2 || segment[1].empty() || *end != '\0' || static_cast<uint32_t>(offered) != dictionary) {
+		pendingSend_.append("{#|Dictionary mismatch, expected " + std::to_string(dictionary) + "}");
+		return;
+	}
+
+	// Delta frames are per recipient and can't share the lobby's compressed frames
+	deltaEnabled_ = false;
+	compressing_ = true;
+	pendingSend_.append("{#|Compression on}");
 }
 
 void hgs::Client::SetCoreCall(std::vector<int>& core_call) { coreCall_.push_back(core_call); }
@@ -282,4 +969,36 @@ void hgs::Client::SetState(const State state) { state_ = state; }
 
 void hgs::Client::SetPrevState(const State state) { lastState_ = state; };
 
-void hgs::Client::SetOutgoing(std::vector<std::string>& outgoing) { outgoingCommands_ = outgoing; }
+void hgs::Client::SetOutgoing(std::vector<Message>& outgoing) {
+	outgoingCommands_ = outgoing;
+	compressed_ = nullptr;
+}
+
+void hgs::Client::SetSlot(const int slot) { slot_ = slot; }
+
+void hgs::Client::SetSnapshot(std::string snapshot) { snapshot_ = std::move(snapshot); }
+
+void hgs::Client::PumpReliable() {
+	UdpGateway& udp = sharedMemory_->GetUdp();
+	const int64_t now = clock_->Now();
+
+	std::vector<std::string> datagrams;
+	udp.TakeReliable(id, datagrams);
+	for (auto& datagram : datagrams) {
+		reliable_.OnDatagram(datagram, now);
+	}
+
+	datagrams.clear();
+	reliable_.Flush(now, datagrams);
+	for (auto& datagram : datagrams) {
+		udp.SendRaw(id, datagram);
+	}
+}
+
+bool hgs::Client::IsUdpBound() const {
+	return sharedMemory_->GetUdp().IsOpen() && sharedMemory_->GetUdp().IsBound(id);
+}
+
+void hgs::Client::SetSessionToken(std::string token) { sessionToken_ = std::move(token); }
+
+void hgs::Client::SetCompressed(std::shared_ptr<const std::string> compressed) { compressed_ = std::move(compressed); }
@@ -2,6 +2,16 @@
 #include "shared_memory.h"
 #include "lobby.h"
 #include "utilities.h"
+#include "message.h"
+#include "link_quality.h"
+#include "transport.h"
+#include "clock.h"
+#include "delta.h"
+#include "interest.h"
+#include "store.h"
+#include "reliable.h"
+#include "send_rate.h"
+#include "ingress.h"
 
 /**
     Client.h
@@ -17,9 +27,23 @@ namespace hgs {
 	class SharedMemory;
 	class SharedLobbyMemory;
 
+	// Control frames start with this byte: "#join|lobby", every other message is data
+	constexpr char apiMarker = '#';
+
 	class Client {
 	public:
+		// Longest message kept across reads without an ingress frame limit
+		static constexpr size_t maxPartial = 1 << 20;
+
 		Client(SOCKET socket, gsl::not_null<SharedMemory*> shared_memory, int id, int lobby_id);
+		/**
+			Create a client on any transport, the
+			socket constructor wraps its socket in
+			a SocketTransport
+
+			@param transport Connection to the remote end, owned by the client
+		 */
+		Client(std::unique_ptr<Transport> transport, gsl::not_null<SharedMemory*> shared_memory, int id, int lobby_id);
 		~Client();
 
 		/**
@@ -29,6 +53,21 @@ namespace hgs {
 			@return void
 		 */
 		void Loop();
+		/**
+			One iteration of the client loop, sends or
+			receives if the lobby asks for it. In-process
+			drivers call this instead of running Loop
+
+			@return bool False while the client is between lobbies
+		 */
+		bool Step();
+		/**
+			Put the client on the drop list of its
+			lobby, done once after it went offline
+
+			@return void
+		 */
+		void RequestDrop();
 		/**
 			Method responsible for receiving information
 			from external socket. After receiving data the
@@ -87,11 +126,61 @@ namespace hgs {
 		 */
 		void DropLobbyConnections();
 
-		static bool IsApiCall(std::string& string);
+		/**
+			Hand a new connection to this client if it is
+			suspended and the token matches. Called by the
+			client the connection arrived on, the suspended
+			client takes it over on its next loop iteration
+
+			@param token Resume token from the welcome message
+			@param transport Moved from on success
+			@return bool False if the session can't be resumed
+		 */
+		bool Resume(const std::string& token, std::unique_ptr<Transport>& transport);
+
+		/**
+			Whether a message is a control frame, decided
+			by its first byte alone
+
+			@param string Message as received
+			@return bool
+		 */
+		static bool IsApiCall(const std::string& string);
+		/**
+			Run a control frame through the command table
+
+			@param call Control frame as received
+			@return void
+		 */
 		void PerformApiCall(std::string& call);
 
 		// Getter
-		std::string GetCommand() const { return clientCommand_; };
+		// Frames of the received response in arrival order, the lobby clears them once queued
+		std::vector<Message>& GetReceived() { return received_; };
+		LinkStats GetLinkStats() const { return link_.GetStats(); };
+		bool IsDeltaEnabled() const { return deltaEnabled_; };
+		double GetDeltaSavings() const { return delta_.Savings(); };
+		bool IsCompressing() const { return compressing_; };
+		bool IsReliable() const { return reliableEnabled_; };
+		// Ticks between sends, above 1 while the link can't keep up
+		int GetSendInterval() const { return rate_.GetInterval(); };
+		int64_t GetThroughput() const { return rate_.GetThroughput(); };
+		bool IsIngressLimited() const { return ingress_.IsEnabled(); };
+		IngressStats GetIngressStats() const { return ingress_.GetStats(); };
+		int64_t GetReliableRto() const { return reliable_.GetRto(); };
+		uint64_t GetRetransmits() const { return reliable_.GetRetransmits(); };
+		// Store mutations of the received response, the lobby clears them once applied
+		std::vector<StoreMutation>& GetMutations() { return mutations_; };
+		int GetSlot() const { return slot_; };
+		// Set when the received response carried a position header
+		bool HasMoved() const { return moved_; };
+		Position GetPosition() const { return position_; };
+		bool IsOnline() const { return isOnline_; };
+		// Connection lost, the session is held for the resume grace period
+		bool IsSuspended() const { return suspended_; };
+		// The connection was handed to a resumed client, leaves without a disconnect frame
+		bool HasHandedOver() const { return handedOver_; };
+		bool IsAttached() const { return attached_; };
 		State& GetState() { return state_; };
 		SOCKET& GetSocket() { return socket_; };
 
@@ -105,8 +194,172 @@ namespace hgs {
 		void SetPause(bool pause);
 		void SetState(State state);
 		void SetPrevState(State state);
-		void SetOutgoing(std::vector<std::string>& outgoing);
+		/**
+			Hand over the outgoing frames of the tick, this
+			also forgets the compressed frames of the last tick
+
+			@param outgoing Frames of every sender
+			@return void
+		 */
+		void SetOutgoing(std::vector<Message>& outgoing);
+		/**
+			Frames of the tick compressed once by the lobby,
+			sent instead of the unsampled outgoing frames
+
+			@param compressed Marker and compressed frames, nullptr to send as is
+			@return void
+		 */
+		void SetCompressed(std::shared_ptr<const std::string> compressed);
+		void SetSlot(int slot);
+		/**
+			Catch-up payload of the lobby the client joins,
+			sent ahead of the frames of its first tick
+
+			@param snapshot Frames from before the join, empty for none
+			@return void
+		 */
+		void SetSnapshot(std::string snapshot);
+		// Token from the welcome message, resumes the session and binds the UDP address
+		void SetSessionToken(std::string token);
 	private:
+		/**
+			Perform a received control frame or prepare a
+			data frame and add it to the received frames
+
+			@param message One message as received, moved from
+			@param received_at Arrival time for sampling
+			@param sample Count the frame towards the latency sample rate
+			@return void
+		 */
+		void TakeMessage(std::string& message, int64_t received_at, bool sample);
+		/**
+			Check a message against the ingress limits by its
+			length, before it is copied or parsed. Kicks the
+			client once the violations escalate that far
+
+			@param bytes Length of the message
+			@return IngressLimiter::Verdict
+		 */
+		IngressLimiter::Verdict Admit(size_t bytes);
+		/**
+			Hold the unterminated tail of a read until
+			the next read completes it. A message that
+			outgrows the frame limit is dropped whole
+
+			@param start First byte of the tail
+			@param end One past the last byte of the read
+			@return void
+		 */
+		void KeepPartial(const char* start, const char* end);
+		/**
+			Take the client offline and tell the lobby
+			with a disconnect frame
+
+			@param reason Logged
+			@return void
+		 */
+		void Disconnect(const std::string& reason);
+
+		struct ApiCommand {
+			const char* name;
+			// Segments the call needs, the name included
+			size_t segments;
+			void (Client::*perform)(const std::vector<std::string>& segment);
+		};
+		static const ApiCommand apiCommands_[];
+
+		// Handlers of the command table, segment[0] is the command name
+		void ApiJoin(const std::vector<std::string>& segment);
+		void ApiLeave(const std::vector<std::string>& segment);
+		void ApiPong(const std::vector<std::string>& segment);
+		void ApiSubscribe(const std::vector<std::string>& segment);
+		void ApiUnsubscribe(const std::vector<std::string>& segment);
+		void ApiStore(const std::vector<std::string>& segment);
+		void ApiResume(const std::vector<std::string>& segment);
+		void ApiReliable(const std::vector<std::string>& segment);
+		void ApiDelta(const std::vector<std::string>& segment);
+		void ApiCompress(const std::vector<std::string>& segment);
+
+		/**
+			Read the headers of a received frame and wrap
+			it in "{id|...}", the frame is cleared if it
+			has no recipients
+
+			@param received_at Arrival time for sampling
+			@param sample Count the frame towards the latency sample rate
+			@return void
+		 */
+		void PrepareFrame(int64_t received_at, bool sample);
+		bool IsUdpBound() const;
+		/**
+			Feed the reliable datagrams that arrived to the
+			channel and send the acks, fragments and
+			retransmits that are due
+
+			@return void
+		 */
+		void PumpReliable();
+		/**
+			Keep the session after losing the connection,
+			the client keeps answering the lobby and
+			buffers what it would have sent
+
+			@return bool False if sessions can't be resumed
+		 */
+		bool Suspend();
+		/**
+			Switch to the connection handed over by Resume
+			and replay the buffered payloads on it
+
+			@return void
+		 */
+		void TakeOver();
+		/**
+			Give up a suspended session, the client
+			is dropped like any lost connection
+
+			@param reason Logged
+			@return void
+		 */
+		void Expire(const std::string& reason);
+		/**
+			Collect the indices of the outgoing frames the
+			interest grid lets through, in sending order
+
+			@return void
+		 */
+		void SelectFrames();
+		bool IsRecipient(const Message& message) const;
+		/**
+			Keep a frame of a skipped tick for the next send,
+			replacing the older state frame of its sender
+			and channel
+
+			@param message Frame of the tick
+			@return void
+		 */
+		void Hold(const Message& message);
+		/**
+			Append a sampled message to the payload with a latency
+			header in front of its content. The build and send stamps
+			are left as placeholders and patched by Send
+
+			@param outgoing Payload under construction
+			@param message Sampled message
+			@return size_t Offset of the build stamp in the payload
+		 */
+		size_t AppendStamped(std::string& outgoing, const Message& message) const;
+		/**
+			Append one outgoing message to the payload if
+			the client is one of its recipients
+
+			@param outgoing Payload under construction
+			@param message Message of the tick
+			@param delta Encode against the last frame of the sender
+			@param stamp_at Offsets of build stamps and pickup times, appended to for sampled messages
+			@return void
+		 */
+		void AppendMessage(std::string& outgoing, const Message& message, bool delta, std::vector<std::pair<size_t, int64_t>>& stamp_at);
 
 		// Alive status of the socket
 		bool isOnline_;
@@ -115,19 +368,96 @@ namespace hgs {
 		bool attached_;
 
 		SOCKET socket_;
+		std::unique_ptr<Transport> transport_;
+		// Time source of the shared memory
+		Clock* clock_;
 
 		std::chrono::microseconds loopInterval_;
 
 		// Shared pointer to logger
 		std::shared_ptr<spdlog::logger> log_;
 
-		// Received response from client socket
+		// Frames of the received response
+		std::vector<Message> received_;
+		// Frame being prepared and its headers
 		std::string clientCommand_;
+		// Stamps of the frame, only set when it was sampled
+		std::shared_ptr<LatencyStamps> stamps_;
+		// Channel the frame is tagged with, -1 for none
+		int channel_;
+		// The frame carries the state marker
+		bool stateFrame_;
+		// Recipients the frame is addressed to, empty for everyone
+		std::vector<int> targets_;
+		// Position of the client in the channel bitsets and interest grid of its lobby
+		int slot_;
+		// Last reported position, moved_ is only set for the current response
+		Position position_;
+		bool moved_;
+		// Store mutations sent with #set, #inc and #cas, applied by the lobby in tick order
+		std::vector<StoreMutation> mutations_;
+		// Slots within the interest radius, reused every send
+		std::vector<int> nearby_;
+		// Outgoing frames for this client, reused every send
+		std::vector<size_t> selected_;
+		// Send every n:th tick on slow links, the frames in between are merged into held_
+		SendRateControl rate_;
+		std::vector<Message> held_;
+		// Position in held_ of the state frame of a sender and channel
+		std::unordered_map<uint64_t, size_t> heldIndex_;
+		// Message and byte rates and the size limit of what the client sends
+		IngressLimiter ingress_;
+		// Start of a message whose NUL hasn't arrived yet, completed by the next read
+		std::string partial_;
+		// The rest of a message is skipped up to its NUL once it outgrew the limit
+		bool skippingPartial_;
+		// Sample every n:th message, 0 disables latency tracing
+		int sampleRate_;
+		int sampleCounter_;
+
+		// Round trip, jitter and loss measured with ping frames
+		LinkQuality link_;
+		uint32_t pingSequence_;
+		int64_t lastPingAt_;
+		// Microseconds between pings, 0 disables probing
+		int64_t pingInterval_;
+		int64_t pingTimeout_;
+		// Frames are sent as field deltas once the client asked for it with #delta
+		DeltaEncoder delta_;
+		std::atomic<bool> deltaEnabled_;
+		int keyframeInterval_;
+		// Payloads carry the lobby's compressed frames once the client asked for it with #compress
+		std::atomic<bool> compressing_;
+		std::shared_ptr<const std::string> compressed_;
 		// Awaiting commands for coreCall
 		std::string pendingSend_;
+		// Frames the lobby sent before the client joined, cleared once sent
+		std::string snapshot_;
+
+		// Response came in over UDP
+		bool unreliable_;
+		// Unreliable frames of the current send, only collected for bound clients
+		bool sendDatagrams_;
+		std::string datagrams_;
+		// Replies and core calls go over UDP once the client asked for it with #reliable
+		ReliableChannel reliable_;
+		std::atomic<bool> reliableEnabled_;
+
+		// Session resumption, disabled without a token
+		std::string sessionToken_;
+		int64_t resumeGrace_;
+		size_t resumeBufferTicks_;
+		std::atomic<bool> suspended_;
+		int64_t suspendedAt_;
+		bool handedOver_;
+		// Payloads built while suspended, replayed in order on resume
+		std::deque<std::string> missed_;
+		// Connection waiting to be taken over, guarded by resumeMtx_
+		std::unique_ptr<Transport> handover_;
+		std::mutex resumeMtx_;
 
 		// Dynamic allocated array holding outgoing commands
-		std::vector<std::string> outgoingCommands_;
+		std::vector<Message> outgoingCommands_;
 
 		State state_;
 		State lastState_;
@@ -0,0 +1,11 @@
+#include "pch.h"
+#include "clock.h"
+#include "utilities.h"
+
+int64_t hgs::SystemClock::Now() const {
+	return utilities::NowMicroseconds();
+}
+
+void hgs::SystemClock::Sleep(const std::chrono::microseconds duration) {
+	std::this_thread::sleep_for(duration);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Clock.h
+	Purpose: Source of time and sleeping for lobbies and clients. The server
+	runs on the system clock, in-process drivers such as the simulation
+	substitute a virtual clock so hours of ticks pass in seconds
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	class Clock {
+	public:
+		virtual ~Clock() = default;
+		/**
+			Monotonic time in microseconds, comparable
+			between threads
+
+			@return int64_t
+		 */
+		virtual int64_t Now() const = 0;
+		/**
+			Block the calling thread for a duration. A virtual
+			clock advances its time instead of blocking
+
+			@param duration Time to sleep
+			@return void
+		 */
+		virtual void Sleep(std::chrono::microseconds duration) = 0;
+	};
+
+	class SystemClock : public Clock {
+	public:
+		int64_t Now() const override;
+		void Sleep(std::chrono::microseconds duration) override;
+	};
+
+}
@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "compressor.h"
+
+// Definitions for C++14, push_back and std::min take the constants by reference
+constexpr char hgs::Compressor::escape;
+constexpr size_t hgs::Compressor::maxDictionary;
+
+hgs::Compressor::Compressor(std::string dictionary) : dictionary_(std::move(dictionary)), id_(2166136261u), table_(size_t(1) << hashBits, -1) {
+	if (dictionary_.size() > maxDictionary) {
+		dictionary_.erase(0, dictionary_.size() - maxDictionary);
+	}
+
+	for (char character : dictionary_) {
+		id_ = (id_ ^ static_cast<unsigned char>(character)) * 16777619u;
+	}
+
+	for (size_t i = 0; i + minMatch <= dictionary_.size(); i++) {
+		table_[Hash(&dictionary_[i])] = static_cast<int32_t>(i);
+	}
+}
+
+void hgs::Compressor::Compress(const char* data, const size_t length, std::string& compressed) const {
+	compressed.clear();
+
+	// Matches may reach back into the dictionary
+	std::string window;
+	window.reserve(dictionary_.size() + length);
+	window.append(dictionary_);
+	window.append(data, length);
+
+	std::vector<int32_t> table = table_;
+	const size_t end = window.size();
+	size_t at = dictionary_.size();
+
+	while (at < end) {
+		if (at + minMatch <= end) {
+			const size_t hash = Hash(&window[at]);
+			const int32_t candidate = table[hash];
+			table[hash] = static_cast<int32_t>(at);
+
+			if (candidate >= 0 && at - static_cast<size_t>(candidate) <= maxOffset &&
+				memcmp(&window[static_cast<size_t>(candidate)], &window[at], minMatch) == 0) {
+
+				const size_t from = static_cast<size_t>(candidate);
+				size_t matched = minMatch;
+				while (at + matched < end && matched < maxMatch && window[from + matched] == window[at + matched]) {
+					matched++;
+				}
+
+				const size_t offset = at - from - 1;
+				compressed.push_back(escape);
+				compressed.push_back(static_cast<char>(matched - 2));
+				compressed.push_back(static_cast<char>(offset / 255 + 1));
+				compressed.push_back(static_cast<char>(offset % 255 + 1));
+
+				for (size_t skipped = at + 1; skipped < at + matched && skipped + minMatch <= end; skipped++) {
+					table[Hash(&window[skipped])] = static_cast<int32_t>(skipped);
+				}
+				at += matched;
+				continue;
+			}
+		}
+
+		// Literal, the escape byte itself is doubled
+		compressed.push_back(window[at]);
+		if (window[at] == escape) {
+			compressed.push_back(escape);
+		}
+		at++;
+	}
+}
+
+bool hgs::Compressor::Decompress(const char* data, const size_t length, std::string& decompressed) const {
+	std::string window;
+	window.reserve(dictionary_.size() + length * 4);
+	window.append(dictionary_);
+
+	size_t at = 0;
+	while (at < length) {
+		if (data[at] != escape) {
+			window.push_back(data[at++]);
+			continue;
+		}
+		if (at + 1 >= length) return false;
+
+		const size_t code = static_cast<unsigned char>(data[at + 1]);
+		if (code == 1) {
+			window.push_back(escape);
+			at += 2;
+			continue;
+		}
+		if (at + 3 >= length) return false;
+
+		const size_t matched = code + 2;
+		const size_t offset = (static_cast<unsigned char>(data[at + 2]) - 1u) * 255u + (static_cast<unsigned char>(data[at + 3]) - 1u) + 1u;
+		if (code == 0 || offset > window.size()) return false;
+
+		// Byte by byte, a match may overlap what it produces
+		size_t from = window.size() - offset;
+		for (size_t i = 0; i < matched; i++) {
+			window.push_back(window[from++]);
+		}
+		at += 4;
+	}
+
+	decompressed.assign(window, dictionary_.size(), std::string::npos);
+	return true;
+}
+
+std::string hgs::Compressor::Train(const std::vector<std::string>& samples, size_t size) {
+	// Sequences are counted as 8 byte words, picked in 32 byte segments
+	constexpr size_t word = 8;
+	constexpr size_t segment = 32;
+	size = std::min(size, maxDictionary);
+
+	auto key = [](const std::string& sample, const size_t at) {
+		uint64_t value = 0;
+		memcpy(&value, sample.data() + at, word);
+		return value;
+	};
+
+	// Number of samples each word occurs in
+	std::unordered_map<uint64_t, uint32_t> frequency;
+	std::vector<uint64_t> words;
+	for (auto& sample : samples) {
+		if (sample.size() < word) continue;
+		words.clear();
+		for (size_t at = 0; at + word <= sample.size(); at++) {
+			words.push_back(key(sample, at));
+		}
+		std::sort(words.begin(), words.end());
+		words.erase(std::unique(words.begin(), words.end()), words.end());
+		for (uint64_t value : words) {
+			frequency[value]++;
+		}
+	}
+
+	struct Candidate {
+		uint64_t score;
+		size_t sample;
+		size_t at;
+		size_t length;
+		bool operator<(const Candidate& other) const { return score < other.score; }
+	};
+
+	// Words that recur are worth their count, the rest nothing
+	auto score = [&](const Candidate& candidate) {
+		uint64_t total = 0;
+		const std::string& sample = samples[candidate.sample];
+		for (size_t at = candidate.at; at + word <= candidate.at + candidate.length; at++) {
+			auto found = frequency.find(key(sample, at));
+			if (found != frequency.end() && found->second > 1) {
+				total += found->second;
+			}
+		}
+		return total;
+	};
+
+	std::priority_queue<Candidate> candidates;
+	for (size_t i = 0; i < samples.size(); i++) {
+		const size_t length = samples[i].size();
+		if (length < word) continue;
+		for (size_t at = 0; at < length; at += segment / 2) {
+			Candidate candidate = { 0, i, at, std::min(segment, length - at) };
+			if (candidate.length < word) break;
+			candidate.score = score(candidate);
+			if (candidate.score > 0) {
+				candidates.push(candidate);
+			}
+		}
+	}
+
+	// Lazy greedy, a candidate is rescored when it reaches the top
+	std::string dictionary;
+	while (!candidates.empty() && dictionary.size() < size) {
+		Candidate best = candidates.top();
+		candidates.pop();
+
+		best.score = score(best);
+		if (best.score == 0) continue;
+		if (!candidates.empty() && best.score < candidates.top().score) {
+			candidates.push(best);
+			continue;
+		}
+
+		const std::string& sample = samples[best.sample];
+		const size_t length = std::min(best.length, size - dictionary.size());
+		// The last bytes are closest to the payload, the best segments go there
+		dictionary.insert(0, sample, best.at, length);
+
+		// Words already in the dictionary are worth nothing to later segments
+		for (size_t at = best.at; at + word <= best.at + best.length; at++) {
+			frequency[key(sample, at)] = 0;
+		}
+	}
+	return dictionary;
+}
+
+bool hgs::Compressor::ReadSessionLog(const std::string& path, std::vector<std::string>& samples) {
+	std::ifstream file(path);
+	if (!file.is_open()) return false;
+
+	// Lines are "[date] Client#id {id|payload}"
+	std::string line;
+	while (std::getline(file, line)) {
+		const size_t frame = line.find('{');
+		if (frame == std::string::npos) continue;
+		samples.push_back(line.substr(frame));
+	}
+	return true;
+}
+
+size_t hgs::Compressor::Hash(const char* at) {
+	uint32_t value;
+	memcpy(&value, at, sizeof(value));
+	return (value * 2654435761u) >> (32 - hashBits);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Compressor.h
+	Purpose: Dependency free LZ77 compressor for tick payloads. The
+	window starts with a shared dictionary trained from session logs
+	so even short payloads find matches. The output never contains
+	NUL so compressed payloads keep the NUL terminated framing
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// First byte of the compressed part of a payload, never part of a text frame
+	constexpr char compressedMarker = '\x02';
+
+	class Compressor {
+	public:
+		// Matches are written as escape, length and a two digit base 255 offset
+		static constexpr char escape = '\x01';
+		static constexpr size_t minMatch = 4;
+		static constexpr size_t maxMatch = 257;
+		static constexpr size_t maxOffset = 255 * 255;
+		static constexpr size_t maxDictionary = 32768;
+
+		/**
+			@param dictionary Content every window starts with,
+			only the last maxDictionary bytes are kept
+		 */
+		explicit Compressor(std::string dictionary = "");
+		/**
+			Compress data against the dictionary, safe to
+			call from several threads at once
+
+			@param data First byte to compress
+			@param length Bytes to compress
+			@param compressed Receives the output, without the marker
+			@return void
+		 */
+		void Compress(const char* data, size_t length, std::string& compressed) const;
+		/**
+			Reverse Compress with the same dictionary
+
+			@param data First byte after the marker
+			@param length Bytes of compressed data
+			@param decompressed Receives the original data
+			@return bool False if the data is malformed
+		 */
+		bool Decompress(const char* data, size_t length, std::string& decompressed) const;
+
+		/**
+			Build a dictionary from recorded frames. Segments
+			holding the byte sequences that recur in the most
+			samples are picked until the dictionary is full
+
+			@param samples Frames or payloads, typically from session logs
+			@param size Dictionary size in bytes
+			@return std::string
+		 */
+		static std::string Train(const std::vector<std::string>& samples, size_t size);
+		/**
+			Read the frames of a lobby session log,
+			one sample per logged line
+
+			@param path Session log file
+			@param samples Receives one entry per frame
+			@return bool False if the file could not be opened
+		 */
+		static bool ReadSessionLog(const std::string& path, std::vector<std::string>& samples);
+
+		// Getters
+		const std::string& GetDictionary() const { return dictionary_; };
+		// FNV-1a hash of the dictionary, clients send it to prove they hold the same one
+		uint32_t GetId() const { return id_; };
+	private:
+		static constexpr int hashBits = 12;
+
+		static size_t Hash(const char* at);
+
+		std::string dictionary_;
+		uint32_t id_;
+		// Last dictionary position of every hash, copied at the start of every window
+		std::vector<int32_t> table_;
+	};
+
+}
@@ -2,13 +2,44 @@
 #include "core.h"
 #include "rcon_client.h"
 #include "utilities.h"
+#include "trace.h"
+#include "impaired_transport.h"
+#include "websocket.h"
 
 //https://www.ibm.com/support/knowledgecenter/en/ssw_ibm_i_72/rzab6/xnonblock.htm
 
+// Unix domain socket files carry their own reparse tag, missing in older SDKs
+#ifndef IO_REPARSE_TAG_AF_UNIX
+#define IO_REPARSE_TAG_AF_UNIX 0x80000023L
+#endif
+
+namespace {
+	/**
+		Check what a unix domain socket path names
+
+		@param path Path of the socket file
+		@return int 0 if nothing is there, 1 for a socket file, -1 for anything else
+	 */
+	int ProbeSocketPath(const std::string& path) {
+		const DWORD attributes = GetFileAttributesA(path.c_str());
+		if (attributes == INVALID_FILE_ATTRIBUTES) return 0;
+		if ((attributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0) return -1;
+
+		WIN32_FIND_DATAA data;
+		const HANDLE find = FindFirstFileA(path.c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE) return -1;
+		FindClose(find);
+		return data.dwReserved0 == IO_REPARSE_TAG_AF_UNIX ? 1 : -1;
+	}
+}
+
 hgs::Core::Core() {
 	rconIndex_ = 1;
 	rconConnections_ = 0;
 	seed_ = 0;
+	localListening_ = INVALID_SOCKET;
+	localBound_ = false;
+	webListening_ = INVALID_SOCKET;
 	running_ = true;
 	ready = true;
 
@@ -60,6 +91,19 @@ hgs::Core::~Core() {
 }
 
 void hgs::Core::CleanUp() const {
+	sharedMemory_->GetUdp().Close();
+
+	if (localListening_ != INVALID_SOCKET) {
+		closesocket(localListening_);
+		// Only the socket file this run created
+		if (localBound_) {
+			std::remove(conf_.localPath.c_str());
+		}
+	}
+	if (webListening_ != INVALID_SOCKET) {
+		closesocket(webListening_);
+	}
+
 	// Clean up server
 	WSACleanup();
 
@@ -95,6 +139,12 @@ hgs::Configuration hgs::Core::SetupConfig() const {
 			else if (selector == "timeout_delay") {
 				configuration.timeoutDelay = std::stof(value);
 			}
+			else if (selector == "ping_interval") {
+				configuration.pingInterval = std::stoi(value);
+			}
+			else if (selector == "ping_timeout") {
+				configuration.pingTimeout = std::stoi(value);
+			}
 			else if (selector == "max_connections") {
 				configuration.maxConnections = std::stoi(value);
 			}
@@ -123,6 +173,87 @@ hgs::Configuration hgs::Core::SetupConfig() const {
 			else if (selector == "lobby.session_logging") {
 				configuration.lobbySessionLogging = value == "true";
 			}
+			else if (selector == "lobby.adaptive_timeout") {
+				configuration.lobbyAdaptiveTimeout = value == "true";
+			}
+			else if (selector == "lobby.max_channels") {
+				configuration.lobbyMaxChannels = std::stoi(value);
+			}
+			else if (selector == "lobby.coalesce") {
+				configuration.lobbyCoalesce = value == "true";
+			}
+			else if (selector == "decimation.enable") {
+				configuration.decimationEnable = value == "true";
+			}
+			else if (selector == "decimation.max_interval") {
+				configuration.decimationMaxInterval = std::stoi(value);
+			}
+			else if (selector == "decimation.rtt") {
+				configuration.decimationRtt = std::stoi(value);
+			}
+			else if (selector == "ingress.max_frame") {
+				configuration.ingressMaxFrame = std::stoi(value);
+			}
+			else if (selector == "ingress.messages_per_second") {
+				configuration.ingressMessagesPerSecond = std::stoi(value);
+			}
+			else if (selector == "ingress.bytes_per_second") {
+				configuration.ingressBytesPerSecond = std::stoi(value);
+			}
+			else if (selector == "ingress.throttle_after") {
+				configuration.ingressThrottleAfter = std::stoi(value);
+			}
+			else if (selector == "ingress.kick_after") {
+				configuration.ingressKickAfter = std::stoi(value);
+			}
+			else if (selector == "admission.max_per_address") {
+				configuration.admissionMaxPerAddress = std::stoi(value);
+			}
+			else if (selector == "admission.per_minute") {
+				configuration.admissionPerMinute = std::stoi(value);
+			}
+			else if (selector == "admission.burst") {
+				configuration.admissionBurst = std::stoi(value);
+			}
+			else if (selector == "admission.blocklist") {
+				configuration.admissionBlocklist = value;
+			}
+			else if (selector == "interest.cell_size") {
+				configuration.interestCellSize = std::stof(value);
+			}
+			else if (selector == "interest.radius") {
+				configuration.interestRadius = std::stof(value);
+			}
+			else if (selector == "snapshot.enable") {
+				configuration.snapshotEnable = value == "true";
+			}
+			else if (selector == "snapshot.ticks") {
+				configuration.snapshotTicks = std::stoi(value);
+			}
+			else if (selector == "store.max_keys") {
+				configuration.storeMaxKeys = std::stoi(value);
+			}
+			else if (selector == "resume.grace") {
+				configuration.resumeGrace = std::stoi(value);
+			}
+			else if (selector == "resume.buffer_ticks") {
+				configuration.resumeBufferTicks = std::stoi(value);
+			}
+			else if (selector == "udp.enable") {
+				configuration.udpEnable = value == "true";
+			}
+			else if (selector == "local.enable") {
+				configuration.localEnable = value == "true";
+			}
+			else if (selector == "local.path") {
+				configuration.localPath = value;
+			}
+			else if (selector == "websocket.enable") {
+				configuration.webSocketEnable = value == "true";
+			}
+			else if (selector == "websocket.port") {
+				configuration.webSocketPort = std::stoi(value);
+			}
 			else if (selector == "lobby.start_id_at") {
 				configuration.lobbyStartIdAt = std::stoi(value);
 			}
@@ -132,6 +263,48 @@ hgs::Configuration hgs::Core::SetupConfig() const {
 			else if (selector == "start_id_at") {
 				configuration.clientStartIdAt = std::stoi(value);
 			}
+			else if (selector == "latency.sample_rate") {
+				configuration.latencySampleRate = std::stoi(value);
+			}
+			else if (selector == "impairment.enable") {
+				configuration.impairmentEnable = value == "true";
+			}
+			else if (selector == "impairment.latency") {
+				configuration.impairmentLatency = std::stoi(value);
+			}
+			else if (selector == "impairment.jitter") {
+				configuration.impairmentJitter = std::stoi(value);
+			}
+			else if (selector == "impairment.bandwidth") {
+				configuration.impairmentBandwidth = std::stoi(value);
+			}
+			else if (selector == "impairment.reorder") {
+				configuration.impairmentReorder = std::stof(value);
+			}
+			else if (selector == "impairment.stall_chance") {
+				configuration.impairmentStallChance = std::stof(value);
+			}
+			else if (selector == "impairment.stall_duration") {
+				configuration.impairmentStallDuration = std::stoi(value);
+			}
+			else if (selector == "impairment.seed") {
+				configuration.impairmentSeed = static_cast<unsigned int>(std::stoul(value));
+			}
+			else if (selector == "delta.enable") {
+				configuration.deltaEnable = value == "true";
+			}
+			else if (selector == "delta.keyframe_interval") {
+				configuration.deltaKeyframeInterval = std::stoi(value);
+			}
+			else if (selector == "compression.enable") {
+				configuration.compressionEnable = value == "true";
+			}
+			else if (selector == "compression.threshold") {
+				configuration.compressionThreshold = std::stoi(value);
+			}
+			else if (selector == "compression.dictionary") {
+				configuration.compressionDictionary = value;
+			}
 		}
 		std::cout << "Configurations loaded!" << std::endl;
 	
@@ -150,6 +323,9 @@ hgs::Configuration hgs::Core::SetupConfig() const {
 		file.put("socket_processing_max", 1);
 		file.put("timeout_tries", 30);
 		file.put("timeout_delay", 0.5);
+		file.put(scl::comment(" Milliseconds between {0|I<seq>} pings, clients have to answer with #pong|<seq> (0 disables)"));
+		file.put("ping_interval", 0);
+		file.put("ping_timeout", 3000);
 		file.put("max_connections", 10);
 		file.put("rcon.enable", "false");
 		file.put("rcon.port", "");
@@ -162,8 +338,64 @@ hgs::Configuration hgs::Core::SetupConfig() const {
 		file.put("lobby.start_id_at", 1);
 		file.put("lobby.session_logging", "false");
 		file.put("lobby.session_path", "sessions/");
+		file.put("lobby.adaptive_timeout", "false");
+		file.put("lobby.max_channels", 64);
+		file.put(scl::comment( Keep only the newest frame marked as state with @v@ per sender and channel within a tick"));
+		file.put("lobby.coalesce", "false");
+		file.put(scl::comment(" Clients on slow links get every n:th tick, up to max_interval, when sends block or the round trip exceeds rtt milliseconds"));
+		file.put("decimation.enable", "false");
+		file.put("decimation.max_interval", 8);
+		file.put("decimation.rtt", 300);
+		file.put(scl::comment(" Per client limits on what it sends, 0 disables a limit. A client that breaks them throttle_after times within 10 seconds is not read for a second, kick_after times and it is kicked"));
+		file.put("ingress.max_frame", 0);
+		file.put("ingress.messages_per_second", 0);
+		file.put("ingress.bytes_per_second", 0);
+		file.put("ingress.throttle_after", 20);
+		file.put("ingress.kick_after", 100);
+		file.put(scl::comment(" Checked right after accept, before a client exists. Connections and attempts per minute of one address, 0 disables, and a file of blocked IPv4 prefixes that /Admission block and unblock write back to"));
+		file.put("admission.max_per_address", 0);
+		file.put("admission.per_minute", 0);
+		file.put("admission.burst", 5);
+		file.put("admission.blocklist", "");
+		file.put(scl::comment(" Area of interest for clients that send @p=x,y@ headers, world units (radius 0 disables, cell size close to the radius)"));
+		file.put("interest.cell_size", 100);
+		file.put("interest.radius", 0);
+		file.put(scl::comment(" Joining clients get the latest frame of every sender and the last n ticks in one payload"));
+		file.put("snapshot.enable", "false");
+		file.put("snapshot.ticks", 10);
+		file.put(scl::comment(" Key/value state clients change with #set, #inc and #cas, keys per lobby (0 disables)"));
+		file.put("store.max_keys", 0);
+		file.put(scl::comment(" Lost clients keep their place for the grace period in milliseconds and resume with #resume|<id>|<token> (0 disables)"));
+		file.put("resume.grace", 0);
+		file.put("resume.buffer_ticks", 200);
+		file.put(scl::comment(" UDP on the server port for unreliable state frames, bound with the token from the welcome message"));
+		file.put("udp.enable", "false");
+		file.put(scl::comment(" Unix domain socket for bots and services on the same host, a file path since Windows has no abstract namespace"));
+		file.put("local.enable", "false");
+		file.put("local.path", "gameserver.sock");
+		file.put(scl::comment(" WebSocket listener for browser clients, one binary frame per message"));
+		file.put("websocket.enable", "false");
+		file.put("websocket.port", 15001);
 		file.put(scl::comment(" Client settings"));;
 		file.put("start_id_at", 1);
+		file.put(scl::comment(" Latency tracing, stamp every n:th message (0 disables)"));
+		file.put("latency.sample_rate", 0);
+		file.put(scl::comment(" Network impairment for local testing, milliseconds, kbit/s and percent (seed 0 uses the server seed)"));
+		file.put("impairment.enable", "false");
+		file.put("impairment.latency", 0);
+		file.put("impairment.jitter", 0);
+		file.put("impairment.bandwidth", 0);
+		file.put("impairment.reorder", 0);
+		file.put("impairment.stall_chance", 0);
+		file.put("impairment.stall_duration", 0);
+		file.put("impairment.seed", 0);
+		file.put(scl::comment(" Delta encoding for clients that send #delta, a complete keyframe every n:th payload (0 never)"));
+		file.put("delta.enable", "true");
+		file.put("delta.keyframe_interval", 60);
+		file.put(scl::comment(" Compression for clients that send #compress, payloads below the threshold (bytes) are sent as is"));
+		file.put("compression.enable", "true");
+		file.put("compression.threshold", 256);
+		file.put("compression.dictionary", "");
 
 		// Create file
 		file.write_changes();
@@ -214,6 +446,13 @@ int hgs::Core::SetupWinSock() {
 	// Add listening socket to array
 	FD_SET(listening_, &master);
 
+	if (conf_.localEnable && SetupLocal(master) != 0) {
+		return 1;
+	}
+	if (conf_.webSocketEnable && SetupWebSocket(master) != 0) {
+		return 1;
+	}
+
 	// Generate server seed
 	std::random_device rd;
 	std::default_random_engine gen(rd());
@@ -221,13 +460,94 @@ int hgs::Core::SetupWinSock() {
 
 	log_->info("Server seed is " + std::to_string(seed_));
 
+	if (conf_.impairmentEnable) {
+		log_->warn("Network impairment enabled, " + Impairment::FromConfiguration(conf_).ToString() +
+			" seed " + std::to_string(conf_.impairmentSeed != 0 ? conf_.impairmentSeed : seed_));
+	}
+
 	log_->info("Server port active on " + std::to_string(conf_.serverPort));
 
+	if (conf_.udpEnable) {
+		UdpGateway& udp = sharedMemory_->GetUdp();
+		if (udp.Open(static_cast<unsigned short>(conf_.serverPort)) != 0) {
+			log_->error("Can't bind udp port");
+			return 1;
+		}
+		std::thread udpThread(&UdpGateway::Loop, &udp);
+		udpThread.detach();
+		log_->info("Udp port active on " + std::to_string(conf_.serverPort));
+	}
+
 	// Assign
 	sharedMemory_->SetSockets(master);
 	return 0;
 }
 
+int hgs::Core::SetupLocal(fd_set& master) {
+	localListening_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (localListening_ == INVALID_SOCKET) {
+		log_->error("Can't create local listening socket");
+		return 1;
+	}
+
+	sockaddr_un hint = sockaddr_un();
+	hint.sun_family = AF_UNIX;
+	if (conf_.localPath.empty() || conf_.localPath.size() >= sizeof(hint.sun_path)) {
+		log_->error("Local socket path must be 1 to " + std::to_string(sizeof(hint.sun_path) - 1) + " characters");
+		return 1;
+	}
+
+	memcpy(hint.sun_path, conf_.localPath.c_str(), conf_.localPath.size());
+	const int length = static_cast<int>(offsetof(sockaddr_un, sun_path) + conf_.localPath.size() + 1);
+
+	// A socket left by a run that didn't shut down blocks the bind, any other file is kept
+	const int existing = ProbeSocketPath(conf_.localPath);
+	if (existing < 0) {
+		log_->error("Local socket path " + conf_.localPath + " is taken by a file that isn't a socket");
+		return 1;
+	}
+	if (existing > 0) {
+		std::remove(conf_.localPath.c_str());
+	}
+
+	if (bind(localListening_, reinterpret_cast<const sockaddr*>(&hint), length) == SOCKET_ERROR) {
+		log_->error("Can't bind local socket " + conf_.localPath);
+		return 1;
+	}
+	localBound_ = true;
+	if (listen(localListening_, SOMAXCONN) == SOCKET_ERROR) {
+		log_->error("Can't listen on local socket " + conf_.localPath);
+		return 1;
+	}
+
+	FD_SET(localListening_, &master);
+	log_->info("Local socket active on " + conf_.localPath);
+	return 0;
+}
+
+int hgs::Core::SetupWebSocket(fd_set& master) {
+	webListening_ = socket(AF_INET, SOCK_STREAM, 0);
+	if (webListening_ == INVALID_SOCKET) {
+		log_->error("Can't create websocket listening socket");
+		return 1;
+	}
+
+	sockaddr_in hint = sockaddr_in();
+	hint.sin_family = AF_INET;
+	hint.sin_port = htons(conf_.webSocketPort);
+	hint.sin_addr.S_un.S_addr = INADDR_ANY;
+
+	if (bind(webListening_, reinterpret_cast<const sockaddr*>(&hint), sizeof(hint)) == SOCKET_ERROR ||
+		listen(webListening_, SOMAXCONN) == SOCKET_ERROR) {
+		log_->error("Can't bind websocket port " + std::to_string(conf_.webSocketPort));
+		return 1;
+	}
+
+	FD_SET(webListening_, &master);
+	log_->info("Websocket port active on " + std::to_string(conf_.webSocketPort));
+	return 0;
+}
+
 int hgs::Core::SetupRcon() {
 
 	// Create listening socket
@@ -281,6 +601,7 @@ void hgs::Core::SetupSessionDir() const {
 }
 
 void hgs::Core::Execute() {
+	trace::SetThreadName("Core");
 
 	while(running_) {
 		Loop();
@@ -313,31 +634,61 @@ void hgs::Core::InitializeReceiving(const int select_result, const int rcon_sele
 
 		const SOCKET socket = workingSet_.fd_array[i];
 
-		if (socket == listening_) {
-
-			// Check for new connections
-			const SOCKET newClient = accept(listening_, nullptr, nullptr);
+		if (socket == listening_ || socket == localListening_ || socket == webListening_) {
+			// Local clients share the host, there is no link to impair
+			const bool local = socket == localListening_;
+			const bool web = socket == webListening_;
 
-			// Check if max clients is reached
-			if (conf_.maxConnections <= sharedMemory_->GetConnectedClients()) {
-				// Immediately close socket if max connections is reached
-				closesocket(newClient);
-				break;
-			}
+			// Check for new connections, the address is checked before anything is set up for it
+			const SOCKET newClient = Accept(socket, local);
+			if (newClient == INVALID_SOCKET) break;
 
 			sharedMemory_->AddSocket(newClient);
 
 			// Create and connect it to main lobby
-			auto* clientObject = new Client(newClient, sharedMemory_, clientIndex_, sharedMemory_->GetMainLobby()->GetId());
-
-			// Create a setup message
-			const std::string welcomeMsg = "Successfully connected to server|" + std::to_string(clientIndex_) + "|" + std::to_string(seed_);
+			std::unique_ptr<Transport> transport;
+			// Browser clients get the welcome framed, it waits for the upgrade to finish
+			WebSocketTransport* webTransport = nullptr;
+			if (web) {
+				// Messages may be as long as a client accepts them over TCP
+				const size_t maxMessage = Client::maxPartial;
+				auto webSocket = std::make_unique<WebSocketTransport>(newClient, conf_.ingressMaxFrame > 0 ? static_cast<size_t>(conf_.ingressMaxFrame) : maxMessage);
+				webTransport = webSocket.get();
+				transport = std::move(webSocket);
+			} else {
+				transport = std::make_unique<SocketTransport>(newClient);
+			}
+			if (conf_.impairmentEnable && !local) {
+				// Every link gets its own generator, derived from the seed and the client id
+				const unsigned int linkSeed = (conf_.impairmentSeed != 0 ? conf_.impairmentSeed : seed_) + static_cast<unsigned int>(clientIndex_);
+				transport = std::make_unique<ImpairedTransport>(std::move(transport), Impairment::FromConfiguration(conf_), &sharedMemory_->GetClock(), linkSeed);
+			}
+			auto* clientObject = new Client(std::move(transport), sharedMemory_, clientIndex_, sharedMemory_->GetMainLobby()->GetId());
+
+			// Create a setup message, the token lets the client resume its session and bind a UDP address
+			std::string welcomeMsg = "Successfully connected to server|" + std::to_string(clientIndex_) + "|" + std::to_string(seed_);
+			if (conf_.resumeGrace > 0 || sharedMemory_->GetUdp().IsOpen()) {
+				char token[17];
+				// Every token is read from the system's cryptographic source, a seeded
+				// engine could be predicted from the tokens other connections were given
+				const uint64_t secret = static_cast<uint64_t>(sessionTokens_()) << 32 | sessionTokens_();
+				snprintf(token, sizeof(token), "%016llx", static_cast<unsigned long long>(secret));
+				clientObject->SetSessionToken(token);
+				if (sharedMemory_->GetUdp().IsOpen()) {
+					sharedMemory_->GetUdp().Register(clientIndex_, token);
+				}
+				welcomeMsg.append("|" + std::string(token));
+			}
 
 			// Send the message to the new client
-			send(newClient, welcomeMsg.c_str(), static_cast<int>(welcomeMsg.size()) + 1, 0);
+			if (webTransport != nullptr) {
+				webTransport->Send(welcomeMsg.c_str(), static_cast<int>(welcomeMsg.size()) + 1);
+			} else {
+				send(newClient, welcomeMsg.c_str(), static_cast<int>(welcomeMsg.size()) + 1, 0);
+			}
 
 			// Console message
-			log_->info("Client#" + std::to_string(newClient) + " connected to the server");
+			log_->info("Client#" + std::to_string(newClient) + (local ? " connected to the server over the local socket" : web ? " connected to the server over websocket" : " connected to the server"));
 
 			// Console message
 			log_->info("Client#" + std::to_string(newClient) + " was assigned ID " + std::to_string(clientIndex_));
@@ -385,6 +736,35 @@ void hgs::Core::InitializeReceiving(const int select_result, const int rcon_sele
 	}
 }
 
+SOCKET hgs::Core::Accept(const SOCKET listener, const bool local) {
+	for (int attempt = 0; attempt < acceptBurst; attempt++) {
+		// Only the first accept is known not to block
+		if (attempt > 0) {
+			fd_set readable;
+			FD_ZERO(&readable);
+			FD_SET(listener, &readable);
+			timeval immediate = { 0, 0 };
+			if (select(0, &readable, nullptr, nullptr, &immediate) <= 0) break;
+		}
+
+		sockaddr_in address = sockaddr_in();
+		int length = sizeof(address);
+		const SOCKET accepted = local ? accept(listener, nullptr, nullptr) : accept(listener, reinterpret_cast<sockaddr*>(&address), &length);
+		if (accepted == INVALID_SOCKET) break;
+
+		const bool full = conf_.maxConnections <= sharedMemory_->GetConnectedClients();
+		if (!full && (local || sharedMemory_->GetAdmission().Admit(ntohl(address.sin_addr.S_un.S_addr), accepted, sharedMemory_->GetClock().Now()) == Admission::verdict_admit)) {
+			return accepted;
+		}
+
+		// Refused connections are reset instead of closed, nothing is sent and no TIME_WAIT is left behind
+		linger abort = { 1, 0 };
+		setsockopt(accepted, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&abort), sizeof(abort));
+		closesocket(accepted);
+	}
+	return INVALID_SOCKET;
+}
+
 void hgs::Core::BroadcastCoreCall(int lobby, int receiver, int command) const {
 	Lobby* current = sharedMemory_->GetFirstLobby();
 
@@ -546,6 +926,34 @@ std::pair<int, std::string> hgs::Core::Interpreter(std::string& input) {
 			log_->warn(statusMessage);
 			return std::make_pair(1, statusMessage);
 		}
+		else if (part.size() >= 4 && part[2] == "interest") {
+			Lobby* lobby;
+			if (utilities::IsInt(part[1])) {
+				lobby = sharedMemory_->FindLobby(std::stoi(part[1]));
+			}
+			else {
+				lobby = sharedMemory_->FindLobby(part[1]);
+			}
+
+			if (lobby == nullptr) {
+				statusMessage = "Could not find lobby";
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+
+			float radius;
+			try {
+				radius = std::stof(part[3]);
+			} catch (std::exception&) {
+				statusMessage = "Radius has to be a number";
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+
+			lobby->SetInterestRadius(radius);
+			statusMessage = (radius > 0.0f ? "Interest radius set to " + part[3] : "Interest filtering disabled");
+			log_->info(statusMessage);
+		}
 		// Second argument is lobby, third is client
 		else if (part.size() >= 4 && part[2] == "summon" && utilities::IsInt(part[3])) {
 			// Get targeted lobby
@@ -578,6 +986,123 @@ std::pair<int, std::string> hgs::Core::Interpreter(std::string& input) {
 			return std::make_pair(1, statusMessage);
 		}
 	}
+	else if (part[0] == "/Trace") {
+		if (part.size() >= 2 && part[1] == "start") {
+			trace::Start();
+			statusMessage = "Tracing started";
+		}
+		else if (part.size() >= 2 && part[1] == "stop") {
+			trace::Stop();
+			statusMessage = "Tracing stopped";
+		}
+		else if (part.size() >= 2 && part[1] == "dump") {
+			const std::string path = (part.size() >= 3 ? part[2] : "trace.json");
+			const int written = trace::Dump(path);
+			if (written == -2) {
+				statusMessage = "Stop tracing before dumping";
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+			if (written < 0) {
+				statusMessage = "Could not open " + path;
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+			statusMessage = "Dumped " + std::to_string(written) + " spans to " + path;
+		}
+		else {
+			statusMessage = "No specifier";
+			log_->warn(statusMessage);
+			return std::make_pair(1, statusMessage);
+		}
+		log_->info(statusMessage);
+	}
+	else if (part[0] == "/Compression") {
+		if (part.size() >= 3 && part[1] == "train") {
+			// A single session log or a directory of them
+			std::vector<std::string> samples;
+			int files = 0;
+			if (std::experimental::filesystem::is_directory(part[2])) {
+				for (auto& entry : std::experimental::filesystem::directory_iterator(part[2])) {
+					if (Compressor::ReadSessionLog(entry.path().string(), samples)) files++;
+				}
+			} else if (Compressor::ReadSessionLog(part[2], samples)) {
+				files++;
+			}
+			if (samples.empty()) {
+				statusMessage = "No frames found in " + part[2];
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+
+			const size_t size = (part.size() >= 4 && utilities::IsInt(part[3]) ? static_cast<size_t>(std::stoi(part[3])) : 4096);
+			const std::string path = (part.size() >= 5 ? part[4] : (conf_.compressionDictionary.empty() ? "compression.dict" : conf_.compressionDictionary));
+			const Compressor trained(Compressor::Train(samples, size));
+
+			std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				statusMessage = "Could not write " + path;
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+			file << trained.GetDictionary();
+
+			// Clients negotiated the current dictionary, the new one is used after a restart
+			statusMessage = "Trained " + std::to_string(trained.GetDictionary().size()) + " byte dictionary from " + std::to_string(samples.size()) +
+				" frames in " + std::to_string(files) + " files, id " + std::to_string(trained.GetId()) + ", written to " + path + ", set compression.dictionary and restart to use it";
+		} else {
+			const Compressor& compressor = sharedMemory_->GetCompressor();
+			statusMessage = std::string(conf_.compressionEnable ? "Compression enabled" : "Compression disabled") +
+				", threshold " + std::to_string(conf_.compressionThreshold) + " bytes, dictionary " +
+				std::to_string(compressor.GetDictionary().size()) + " bytes, id " + std::to_string(compressor.GetId());
+		}
+		log_->info(statusMessage);
+	}
+	else if (part[0] == "/Admission") {
+		Admission& admission = sharedMemory_->GetAdmission();
+		if (part.size() >= 3 && (part[1] == "block" || part[1] == "unblock")) {
+			uint32_t prefix = 0;
+			int length = 0;
+			if (!PrefixTrie::Parse(part[2], prefix, length)) {
+				statusMessage = "Not an IPv4 address or prefix: " + part[2];
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+
+			// Connections that are already open stay, drop them with /Client
+			const bool block = part[1] == "block";
+			const std::string name = PrefixTrie::Format(prefix, length);
+			if (!(block ? admission.Block(prefix, length) : admission.Unblock(prefix, length))) {
+				statusMessage = name + (block ? " is already blocked" : " is not blocked");
+				log_->warn(statusMessage);
+				return std::make_pair(1, statusMessage);
+			}
+			statusMessage = (block ? "Blocked " : "Unblocked ") + name;
+			if (!conf_.admissionBlocklist.empty() && !admission.SaveBlocklist(conf_.admissionBlocklist)) {
+				statusMessage.append(", could not write " + conf_.admissionBlocklist);
+			}
+		}
+		else if (part.size() >= 2 && part[1] == "list") {
+			const std::vector<std::pair<uint32_t, int>> blocked = admission.ListBlocked();
+			statusMessage = std::to_string(blocked.size()) + " blocked prefixes";
+			for (auto& prefix : blocked) {
+				statusMessage.append("\n" + PrefixTrie::Format(prefix.first, prefix.second));
+			}
+		}
+		else {
+			statusMessage = admission.ToString();
+		}
+		log_->info(statusMessage);
+	}
+	else if (part[0] == "/Latency") {
+		if (part.size() >= 2 && part[1] == "reset") {
+			sharedMemory_->GetLatency().Reset();
+			statusMessage = "Latency histograms cleared";
+		} else {
+			statusMessage = sharedMemory_->GetLatency().List();
+		}
+		log_->info(statusMessage);
+	}
 	else if (part[0] == "/Stop") {
 		running_ = false;
 	}
@@ -593,6 +1118,19 @@ std::pair<int, std::string> hgs::Core::Interpreter(std::string& input) {
    <lobby> pause - Sends a pause signal to all clients in the targeted lobby\n\
    <lobby> drop - Drops a lobby and all it's content\n\
    <lobby> summon <client> - Transfers a client from one lobby to another\n\
+   <lobby> interest <radius> - Only sends frames of senders within the radius to placed clients, 0 disables\n\
+/Trace\n\
+   start - Starts recording lobby tick phases\n\
+   stop - Stops recording\n\
+   dump <file> - Writes the recording as a Chrome trace (default trace.json)\n\
+/Compression - Shows the compression settings and the dictionary id clients send with #compress\n\
+   train <session log or directory> <size> <file> - Trains a dictionary from session logs (default 4096 bytes)\n\
+/Admission - Shows how many connections were admitted and refused\n\
+   block <address or prefix> - Refuses new connections from an IPv4 address or prefix like 10.0.0.0/8\n\
+   unblock <address or prefix> - Removes a blocked address or prefix\n\
+   list - Lists the blocked prefixes\n\
+/Latency - Lists per-stage latency of sampled messages\n\
+   reset - Clears the latency histograms\n\
 /Stop - Stops the server and closes all connections\n\n\
 For more information about the server console visit the documentation at: https://github.com/Hampfh/GameServer/wiki/Server-Console";
 		statusMessage = commands;
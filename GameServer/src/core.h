@@ -38,6 +38,24 @@ namespace hgs {
 			@return void
 		 */
 		int SetupWinSock();
+		/**
+			Listen on a unix domain socket next to the
+			server port, accepted clients take the same
+			path into the main lobby
+
+			@param master Socket set the listener is added to
+			@return int 0 on success
+		 */
+		int SetupLocal(fd_set& master);
+		/**
+			Listen for browser clients on the websocket
+			port, they upgrade over HTTP and then take
+			the same path into the main lobby
+
+			@param master Socket set the listener is added to
+			@return int 0 on success
+		 */
+		int SetupWebSocket(fd_set& master);
 		/**
 			Setup an environment for rcon, opening
 			necessary ports etc
@@ -79,6 +97,18 @@ namespace hgs {
 			@return void
 		 */
 		void InitializeReceiving(int select_result, int rcon_select_result);
+		/**
+			Accept from a ready listener until a connection
+			is admitted. Refused attempts are reset and the
+			next one in the backlog is taken right away, so
+			a flood is drained without delaying the players
+			queued behind it
+
+			@param listener Listening socket select reported ready
+			@param local Unix domain listener, its clients are never limited
+			@return SOCKET The admitted connection, INVALID_SOCKET for none
+		 */
+		SOCKET Accept(SOCKET listener, bool local);
 		/**
 			Broadcasts the call from core
 			to all lobbies
@@ -98,6 +128,9 @@ namespace hgs {
 		void ConsoleThread();
 		std::pair<int, std::string> ServerCommand(std::string& command);
 
+		// Getters
+		SharedMemory* GetSharedMemory() const { return sharedMemory_; };
+
 		bool ready;
 	private:
 		/**
@@ -110,6 +143,9 @@ namespace hgs {
 		 */
 		std::pair<int, std::string> Interpreter(std::string& input);
 
+		// Connections a listener may refuse in one pass before the loop moves on
+		static constexpr int acceptBurst = 64;
+
 		bool running_;
 
 		int rconConnections_;
@@ -120,6 +156,12 @@ namespace hgs {
 		fd_set rconWorkingSet_;
 
 		SOCKET listening_;
+		// Unix domain listener, INVALID_SOCKET unless local.enable is set
+		SOCKET localListening_;
+		// The socket file exists because this run bound it, removed on clean up
+		bool localBound_;
+		// WebSocket listener, INVALID_SOCKET unless websocket.enable is set
+		SOCKET webListening_;
 
 		std::mutex callInterpreter_;
 
@@ -127,6 +169,8 @@ namespace hgs {
 		int clientIndex_;
 
 		unsigned int seed_;
+		// Source of the session tokens handed out in the welcome message, backed by the OS CSPRNG on MSVC
+		std::random_device sessionTokens_;
 
 		Configuration conf_;
 
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "delta.h"
+
+hgs::DeltaEncoder::DeltaEncoder() : payloads_(0), keyframe_(true), rawBytes_(0), encodedBytes_(0) {
+}
+
+void hgs::DeltaEncoder::Begin(const int keyframe_interval) {
+	keyframe_ = keyframe_interval > 0 && payloads_ % static_cast<uint64_t>(keyframe_interval) == 0;
+	payloads_++;
+}
+
+void hgs::DeltaEncoder::Append(std::string& outgoing, const Message& message) {
+	const std::string& frame = message.frame;
+	rawBytes_ += frame.size();
+
+	// Frames composed by the server are never encoded
+	if (message.sender == serverSender) {
+		outgoing.append(frame);
+		encodedBytes_ += frame.size();
+		return;
+	}
+
+	const size_t payloadAt = frame.find('|') + 1;
+	const size_t length = frame.size() - payloadAt - 1;
+	std::string& baseline = baselines_[message.sender];
+
+	bool encoded = false;
+	if (!keyframe_ && !baseline.empty()) {
+		delta::Encode(baseline, frame.data() + payloadAt, length, scratch_);
+
+		if (scratch_.size() < length) {
+			outgoing.append(frame, 0, payloadAt);
+			outgoing.append(scratch_);
+			outgoing.push_back('}');
+			encodedBytes_ += payloadAt + scratch_.size() + 1;
+			encoded = true;
+		}
+	}
+	if (!encoded) {
+		outgoing.append(frame);
+		encodedBytes_ += frame.size();
+	}
+
+	baseline.assign(frame, payloadAt, length);
+}
+
+void hgs::DeltaEncoder::Store(const Message& message) {
+	const std::string& frame = message.frame;
+	rawBytes_ += frame.size();
+	encodedBytes_ += frame.size();
+	if (message.sender == serverSender) return;
+
+	const size_t payloadAt = frame.find('|') + 1;
+	baselines_[message.sender].assign(frame, payloadAt, frame.size() - payloadAt - 1);
+}
+
+void hgs::DeltaEncoder::Reset() {
+	baselines_.clear();
+	payloads_ = 0;
+	keyframe_ = true;
+}
+
+double hgs::DeltaEncoder::Savings() const {
+	const uint64_t raw = rawBytes_;
+	if (raw == 0) return 0.0;
+	return 1.0 - static_cast<double>(encodedBytes_) / static_cast<double>(raw);
+}
+
+bool hgs::DeltaDecoder::Decode(const int sender, const std::string& body, std::string& payload) {
+	// Sampled frames are always complete, the latency header is not part of the payload
+	if (body.compare(0, 3, "@l=") == 0) {
+		const size_t end = body.find('@', 3);
+		payload = (end == std::string::npos ? body : body.substr(end + 1));
+		baselines_[sender] = payload;
+		return true;
+	}
+
+	if (body.compare(0, 3, deltaHeader) != 0) {
+		payload = body;
+		baselines_[sender] = payload;
+		return true;
+	}
+
+	auto baseline = baselines_.find(sender);
+	const size_t countEnd = body.find('@', 3);
+	if (baseline == baselines_.end() || countEnd == std::string::npos) {
+		return false;
+	}
+	const size_t count = static_cast<size_t>(std::strtoul(body.c_str() + 3, nullptr, 10));
+
+	// Fields of the baseline, padded or cut to the new field count
+	std::vector<std::string> fields;
+	size_t at = 0;
+	while (fields.size() < count) {
+		const size_t end = baseline->second.find('|', at);
+		if (end == std::string::npos) {
+			fields.push_back(baseline->second.substr(at));
+			break;
+		}
+		fields.push_back(baseline->second.substr(at, end - at));
+		at = end + 1;
+	}
+	fields.resize(count);
+
+	// Changed fields, "index=value" separated by '|'
+	at = countEnd + 1;
+	while (at < body.size()) {
+		size_t end = body.find('|', at);
+		if (end == std::string::npos) end = body.size();
+
+		const size_t equals = body.find('=', at);
+		if (equals == std::string::npos || equals > end) return false;
+		const size_t index = static_cast<size_t>(std::strtoul(body.c_str() + at, nullptr, 10));
+		if (index >= count) return false;
+		fields[index].assign(body, equals + 1, end - equals - 1);
+
+		at = end + 1;
+	}
+
+	payload.clear();
+	for (size_t i = 0; i < fields.size(); i++) {
+		if (i > 0) payload.push_back('|');
+		payload.append(fields[i]);
+	}
+	baseline->second = payload;
+	return true;
+}
+
+void hgs::DeltaDecoder::Reset() { baselines_.clear(); }
+
+void hgs::delta::Encode(const std::string& baseline, const char* data, const size_t length, std::string& encoded) {
+	const size_t count = static_cast<size_t>(std::count(data, data + length, '|')) + 1;
+	encoded.assign(deltaHeader);
+	encoded.append(std::to_string(count));
+	encoded.push_back('@');
+
+	// Walk the fields of both payloads side by side
+	size_t at = 0;
+	size_t baseAt = 0;
+	bool baseLeft = true;
+	bool first = true;
+	for (size_t index = 0; ; index++) {
+		const char* bar = static_cast<const char*>(memchr(data + at, '|', length - at));
+		const size_t end = (bar == nullptr ? length : static_cast<size_t>(bar - data));
+
+		bool same = false;
+		if (baseLeft) {
+			size_t baseEnd = baseline.find('|', baseAt);
+			if (baseEnd == std::string::npos) {
+				baseEnd = baseline.size();
+				baseLeft = false;
+			}
+			same = baseEnd - baseAt == end - at && baseline.compare(baseAt, baseEnd - baseAt, data + at, end - at) == 0;
+			baseAt = baseEnd + 1;
+		}
+
+		if (!same) {
+			if (!first) encoded.push_back('|');
+			first = false;
+			encoded.append(std::to_string(index));
+			encoded.push_back('=');
+			encoded.append(data + at, end - at);
+		}
+
+		if (end == length) break;
+		at = end + 1;
+	}
+}
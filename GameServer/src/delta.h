@@ -0,0 +1,120 @@
+#pragma once
+#include "pch.h"
+#include "message.h"
+
+/**
+	Delta.h
+	Purpose: Field level delta encoding of client frames. Every recipient
+	keeps the last payload it got from each sender and only the fields
+	that changed since then are sent. Payload fields are separated by '|'
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// Encoded frames carry a header in front of the changed fields:
+	// "{id|@d=fields@index=value|index=value}"
+	// where fields is the field count of the complete payload. Frames
+	// without the header are complete and become the new baseline
+	constexpr char deltaHeader[] = "@d=";
+
+	/**
+		Server side, one per recipient. The connection is
+		reliable and ordered so the baseline of a sender is
+		simply the last frame sent to the recipient
+	 */
+	class DeltaEncoder {
+	public:
+		DeltaEncoder();
+		/**
+			Start composing a payload, every keyframe
+			interval:th payload is sent without deltas
+
+			@param keyframe_interval Payloads between keyframes, 0 for never
+			@return void
+		 */
+		void Begin(int keyframe_interval);
+		/**
+			Append a frame to the payload, encoded
+			against the baseline of its sender when
+			that is shorter than the complete frame
+
+			@param outgoing Payload under construction
+			@param message Frame to append
+			@return void
+		 */
+		void Append(std::string& outgoing, const Message& message);
+		/**
+			Take a frame that was appended without the
+			encoder as the new baseline of its sender
+
+			@param message Frame sent in full
+			@return void
+		 */
+		void Store(const Message& message);
+		/**
+			Forget every baseline, the next payload
+			is a keyframe
+
+			@return void
+		 */
+		void Reset();
+
+		// Getters
+		uint64_t GetRawBytes() const { return rawBytes_; };
+		uint64_t GetEncodedBytes() const { return encodedBytes_; };
+		/**
+			Share of frame bytes saved so far
+
+			@return double Between 0 and 1
+		 */
+		double Savings() const;
+	private:
+		std::unordered_map<int, std::string> baselines_;
+		// Reused between frames to keep the encoding allocation free
+		std::string scratch_;
+		uint64_t payloads_;
+		bool keyframe_;
+
+		// Read by the console thread
+		std::atomic<uint64_t> rawBytes_;
+		std::atomic<uint64_t> encodedBytes_;
+	};
+
+	/**
+		Client side counterpart, rebuilds the complete
+		payloads from the frames of one connection
+	 */
+	class DeltaDecoder {
+	public:
+		/**
+			Rebuild the payload of a frame and keep it
+			as the baseline of its sender
+
+			@param sender Id of the sending client
+			@param body Frame content between "{id|" and "}"
+			@param payload Complete payload, latency header removed
+			@return bool False if the frame refers to a missing baseline
+		 */
+		bool Decode(int sender, const std::string& body, std::string& payload);
+		void Reset();
+	private:
+		std::unordered_map<int, std::string> baselines_;
+	};
+
+	namespace delta {
+		/**
+			Encode a payload against a baseline
+
+			@param baseline Earlier payload of the same sender
+			@param data First character of the new payload
+			@param length Length of the new payload
+			@param encoded Receives the header and the changed fields
+			@return void
+		 */
+		void Encode(const std::string& baseline, const char* data, size_t length, std::string& encoded);
+	}
+
+}
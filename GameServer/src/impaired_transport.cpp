@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "impaired_transport.h"
+
+hgs::Impairment hgs::Impairment::FromConfiguration(const Configuration& conf) {
+	Impairment impairment;
+	impairment.latency = static_cast<int64_t>(conf.impairmentLatency) * 1000;
+	impairment.jitter = static_cast<int64_t>(conf.impairmentJitter) * 1000;
+	// Configured in kilobits per second
+	impairment.bandwidth = static_cast<int64_t>(conf.impairmentBandwidth) * 1000 / 8;
+	impairment.reorder = static_cast<double>(conf.impairmentReorder) / 100.0;
+	impairment.stallChance = static_cast<double>(conf.impairmentStallChance) / 100.0;
+	impairment.stallDuration = static_cast<int64_t>(conf.impairmentStallDuration) * 1000;
+	return impairment;
+}
+
+std::string hgs::Impairment::ToString() const {
+	char buffer[192];
+	snprintf(buffer, sizeof(buffer), "latency %lldms jitter %lldms bandwidth %s reorder %.1f%% stalls %.2f%% x %lldms",
+		static_cast<long long>(latency / 1000), static_cast<long long>(jitter / 1000),
+		bandwidth > 0 ? (std::to_string(bandwidth * 8 / 1000) + "kbit/s").c_str() : "unlimited",
+		reorder * 100.0, stallChance * 100.0, static_cast<long long>(stallDuration / 1000));
+	return buffer;
+}
+
+hgs::ImpairedTransport::ImpairedTransport(std::unique_ptr<Transport> inner, const Impairment& impairment, const gsl::not_null<Clock*> clock, const unsigned int seed) :
+inner_(std::move(inner)), impairment_(impairment), clock_(clock), random_(seed) {
+	order_ = 0;
+	stalledUntil_ = 0;
+	innerLost_ = false;
+	innerResult_ = 0;
+	passing_ = false;
+}
+
+int hgs::ImpairedTransport::Receive(char* buffer, const int length) {
+	Drain();
+
+	// Clients only receive after Ready, the front message is due
+	if (inbound_.queue.empty()) {
+		return 0;
+	}
+	Held& held = inbound_.queue.front();
+	if (held.lost) {
+		inbound_.queue.pop_front();
+		return innerResult_;
+	}
+
+	// Whatever doesn't fit stays at the front for the next read
+	const int bytes = std::min(static_cast<int>(held.data.size()), length);
+	memcpy(buffer, held.data.data(), static_cast<size_t>(bytes));
+	if (bytes < static_cast<int>(held.data.size())) {
+		held.data.erase(0, static_cast<size_t>(bytes));
+	} else {
+		inbound_.queue.pop_front();
+	}
+	return bytes;
+}
+
+int hgs::ImpairedTransport::Send(const char* data, const int length) {
+	Hold(outbound_, std::string(data, static_cast<size_t>(length)), false, true);
+	Pump();
+	return length;
+}
+
+bool hgs::ImpairedTransport::Ready() {
+	Drain();
+	return !inbound_.queue.empty() && inbound_.queue.front().at <= clock_->Now();
+}
+
+void hgs::ImpairedTransport::Pump() {
+	const int64_t now = clock_->Now();
+	while (!outbound_.queue.empty() && outbound_.queue.front().at <= now) {
+		const std::string& data = outbound_.queue.front().data;
+		inner_->Send(data.data(), static_cast<int>(data.size()));
+		outbound_.queue.pop_front();
+	}
+}
+
+void hgs::ImpairedTransport::Close() {
+	// Whatever is still on the wire is lost with the connection
+	inbound_.queue.clear();
+	outbound_.queue.clear();
+	inner_->Close();
+}
+
+void hgs::ImpairedTransport::Hold(Direction& direction, std::string data, const bool lost, const bool reorderable) {
+	const int64_t now = clock_->Now();
+
+	// Clock the message out at the capped rate, queued messages go first
+	int64_t sentAt = now;
+	if (impairment_.bandwidth > 0) {
+		sentAt = std::max(now, direction.busyUntil) + static_cast<int64_t>(data.size()) * 1000000 / impairment_.bandwidth;
+		direction.busyUntil = sentAt;
+	}
+
+	int64_t at = sentAt + impairment_.latency;
+	if (impairment_.jitter > 0) {
+		at += std::uniform_int_distribution<int64_t>(0, impairment_.jitter)(random_);
+	}
+
+	if (impairment_.stallChance > 0.0 && Chance(impairment_.stallChance)) {
+		stalledUntil_ = std::max(stalledUntil_, now + impairment_.stallDuration);
+	}
+	at = std::max(at, stalledUntil_);
+
+	// In order messages never overtake each other, reordered ones
+	// are held back a second delay and let later messages pass
+	if (reorderable && impairment_.reorder > 0.0 && Chance(impairment_.reorder)) {
+		at += impairment_.latency + impairment_.jitter;
+	} else {
+		at = std::max(at, direction.lastAt);
+		direction.lastAt = at;
+	}
+
+	Held held = { at, order_++, std::move(data), lost };
+	const auto position = std::upper_bound(direction.queue.begin(), direction.queue.end(), held,
+		[](const Held& left, const Held& right) { return left.at != right.at ? left.at < right.at : left.order < right.order; });
+	direction.queue.insert(position, std::move(held));
+}
+
+void hgs::ImpairedTransport::Drain() {
+	while (!innerLost_ && inner_->Ready()) {
+		char incoming[1024];
+		ZeroMemory(incoming, 1024);
+
+		const int bytes = inner_->Receive(incoming, 1024);
+		if (bytes <= 0) {
+			// The loss travels behind the data that was already on its way
+			innerLost_ = true;
+			innerResult_ = bytes;
+			partial_.clear();
+			Hold(inbound_, std::string(), true, false);
+			return;
+		}
+
+		// Reads aren't aligned to messages, only whole messages are held so
+		// a reordered one can't splice its tail onto another message
+		const char* end = incoming + bytes;
+		const char* start = incoming;
+		for (const char* terminator = std::find(start, end, '\0'); terminator != end; terminator = std::find(start, end, '\0')) {
+			partial_.append(start, terminator + 1);
+			Hold(inbound_, std::move(partial_), false, !passing_);
+			partial_.clear();
+			passing_ = false;
+			start = terminator + 1;
+		}
+		partial_.append(start, end);
+		if (partial_.size() > maxPartial) {
+			Hold(inbound_, std::move(partial_), false, false);
+			partial_.clear();
+			passing_ = true;
+		}
+	}
+}
+
+bool hgs::ImpairedTransport::Chance(const double probability) {
+	return std::uniform_real_distribution<double>(0.0, 1.0)(random_) < probability;
+}
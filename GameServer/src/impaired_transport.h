@@ -0,0 +1,119 @@
+#pragma once
+#include "transport.h"
+#include "clock.h"
+#include "utilities.h"
+
+/**
+	ImpairedTransport.h
+	Purpose: Transport decorator emulating a bad network link. Messages in
+	both directions are held back for latency, jitter and a bandwidth cap,
+	a share of them is reordered and the link stalls at random. Every link
+	draws from its own generator so a seed reproduces the same run
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	struct Impairment {
+		// One way delay in microseconds, applied in each direction
+		int64_t latency = 0;
+		// Up to this many microseconds are added to the delay
+		int64_t jitter = 0;
+		// Bytes per second in each direction, 0 is unlimited
+		int64_t bandwidth = 0;
+		// Share of messages held back an extra delay so later ones overtake them
+		double reorder = 0.0;
+		// Chance per message that the link freezes in both directions
+		double stallChance = 0.0;
+		int64_t stallDuration = 0;
+
+		/**
+			Read the impairment.* settings
+
+			@param conf Loaded configuration
+			@return Impairment
+		 */
+		static Impairment FromConfiguration(const Configuration& conf);
+		std::string ToString() const;
+	};
+
+	class ImpairedTransport : public Transport {
+	public:
+		// Inbound bytes without a NUL are held back up to this many, longer
+		// messages pass in order and the client drops them at its frame limit
+		static constexpr size_t maxPartial = 1 << 20;
+
+		/**
+			@param inner The real transport, owned by the decorator
+			@param impairment Link conditions
+			@param clock Time source of the shared memory
+			@param seed Seed of this link's generator
+		 */
+		ImpairedTransport(std::unique_ptr<Transport> inner, const Impairment& impairment, gsl::not_null<Clock*> clock, unsigned int seed);
+
+		int Receive(char* buffer, int length) override;
+		int Send(const char* data, int length) override;
+		bool Ready() override;
+		void Pump() override;
+		void Close() override;
+		SOCKET GetHandle() const override { return inner_->GetHandle(); };
+	private:
+		struct Held {
+			int64_t at;
+			uint64_t order;
+			std::string data;
+			// Stands for the connection being lost
+			bool lost;
+		};
+
+		// One direction of the link, messages wait in release order
+		struct Direction {
+			std::deque<Held> queue;
+			// When the previous message has been clocked out at the bandwidth
+			int64_t busyUntil = 0;
+			// Release time of the latest in order message, later ones never pass it
+			int64_t lastAt = 0;
+		};
+
+		/**
+			Compute when a message becomes visible on
+			the other end and queue it
+
+			@param direction Inbound or outbound
+			@param data The message
+			@param lost Queue a lost connection instead of data
+			@param reorderable The message may be overtaken by later ones
+			@return void
+		 */
+		void Hold(Direction& direction, std::string data, bool lost, bool reorderable);
+		/**
+			Read everything the inner transport has
+			available into the inbound queue, split
+			into whole NUL terminated messages
+
+			@return void
+		 */
+		void Drain();
+		bool Chance(double probability);
+
+		std::unique_ptr<Transport> inner_;
+		const Impairment impairment_;
+		Clock* clock_;
+		default_random_engine random_;
+
+		Direction inbound_;
+		Direction outbound_;
+		uint64_t order_;
+		int64_t stalledUntil_;
+		bool innerLost_;
+		// Start of an inbound message whose NUL hasn't been read yet
+		std::string partial_;
+		// Part of the current inbound message already passed, the rest stays in order
+		bool passing_;
+		// What the inner transport returned when the connection ended
+		int innerResult_;
+	};
+
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "ingress.h"
+
+hgs::IngressLimiter::IngressLimiter() : maxFrame_(0), messageRate_(0.0), byteRate_(0.0), throttleAfter_(0), kickAfter_(0),
+messageTokens_(0.0), byteTokens_(0.0), refilledAt_(-1), strikes_(0), windowStart_(0), throttledUntil_(0),
+accepted_(0), oversized_(0), limited_(0), throttles_(0) {
+}
+
+void hgs::IngressLimiter::Configure(const size_t max_frame, const int messages_per_second, const int bytes_per_second, const int throttle_after, const int kick_after) {
+	maxFrame_ = max_frame;
+	messageRate_ = std::max(messages_per_second, 0);
+	byteRate_ = std::max(bytes_per_second, 0);
+	throttleAfter_ = std::max(throttle_after, 0);
+	kickAfter_ = std::max(kick_after, 0);
+
+	// Start with full buckets
+	messageTokens_ = messageRate_;
+	byteTokens_ = byteRate_;
+	refilledAt_ = -1;
+}
+
+hgs::IngressLimiter::Verdict hgs::IngressLimiter::Admit(const size_t bytes, const int64_t now) {
+	if (maxFrame_ > 0 && bytes > maxFrame_) {
+		oversized_.fetch_add(1, std::memory_order_relaxed);
+		return Strike(now);
+	}
+
+	// A message above one second of bytes needs a full bucket and leaves it in
+	// debt, otherwise it could never be admitted and would end in a kick
+	Refill(now);
+	const double byteCost = std::min(static_cast<double>(bytes), byteRate_);
+	if ((messageRate_ > 0.0 && messageTokens_ < 1.0) || (byteRate_ > 0.0 && byteTokens_ < byteCost)) {
+		limited_.fetch_add(1, std::memory_order_relaxed);
+		return Strike(now);
+	}
+	messageTokens_ -= 1.0;
+	byteTokens_ -= static_cast<double>(bytes);
+
+	accepted_.fetch_add(1, std::memory_order_relaxed);
+	return verdict_admit;
+}
+
+hgs::IngressStats hgs::IngressLimiter::GetStats() const {
+	IngressStats stats;
+	stats.accepted = accepted_.load(std::memory_order_relaxed);
+	stats.oversized = oversized_.load(std::memory_order_relaxed);
+	stats.limited = limited_.load(std::memory_order_relaxed);
+	stats.throttles = throttles_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void hgs::IngressLimiter::Refill(const int64_t now) {
+	if (refilledAt_ >= 0 && now > refilledAt_) {
+		const double seconds = static_cast<double>(now - refilledAt_) / 1000000.0;
+		messageTokens_ = std::min(messageTokens_ + seconds * messageRate_, messageRate_);
+		byteTokens_ = std::min(byteTokens_ + seconds * byteRate_, byteRate_);
+	}
+	refilledAt_ = now;
+}
+
+hgs::IngressLimiter::Verdict hgs::IngressLimiter::Strike(const int64_t now) {
+	if (now - windowStart_ > strikeWindow) {
+		windowStart_ = now;
+		strikes_ = 0;
+	}
+	strikes_++;
+
+	if (kickAfter_ > 0 && strikes_ >= kickAfter_) {
+		return verdict_kick;
+	}
+	if (throttleAfter_ > 0 && strikes_ >= throttleAfter_) {
+		// Every strike past the threshold extends the penalty
+		throttledUntil_ = now + throttleTime;
+		throttles_.fetch_add(1, std::memory_order_relaxed);
+		return verdict_throttle;
+	}
+	return verdict_drop;
+}
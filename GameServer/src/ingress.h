@@ -0,0 +1,95 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Ingress.h
+	Purpose: Bounds what one client may send. Token buckets limit
+	messages and bytes per second and oversized frames are refused,
+	every message is checked on its length alone before anything is
+	parsed or allocated. Repeated violations escalate from dropping
+	the message to throttling the client to kicking it
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	struct IngressStats {
+		uint64_t accepted = 0;
+		// Frames above the size limit
+		uint64_t oversized = 0;
+		// Frames over the message or byte rate
+		uint64_t limited = 0;
+		uint64_t throttles = 0;
+
+		uint64_t Rejected() const { return oversized + limited; };
+	};
+
+	class IngressLimiter {
+	public:
+		enum Verdict {
+			verdict_admit,
+			verdict_drop,
+			// Drop and stop reading from the client for a while
+			verdict_throttle,
+			verdict_kick
+		};
+
+		// Violations only count within this window
+		static constexpr int64_t strikeWindow = 10000000;
+		// Microseconds the client isn't read from once throttled
+		static constexpr int64_t throttleTime = 1000000;
+
+		IngressLimiter();
+		/**
+			Set the limits, 0 disables any of them. The buckets
+			hold one second worth of tokens
+
+			@param max_frame Largest message in bytes
+			@param messages_per_second Message rate
+			@param bytes_per_second Byte rate
+			@param throttle_after Violations in the window before throttling
+			@param kick_after Violations in the window before kicking
+			@return void
+		 */
+		void Configure(size_t max_frame, int messages_per_second, int bytes_per_second, int throttle_after, int kick_after);
+		/**
+			Check one message and take its tokens
+
+			@param bytes Length of the message
+			@param now Microseconds
+			@return Verdict
+		 */
+		Verdict Admit(size_t bytes, int64_t now);
+
+		bool IsEnabled() const { return maxFrame_ > 0 || messageRate_ > 0 || byteRate_ > 0; };
+		bool IsThrottled(const int64_t now) const { return now < throttledUntil_; };
+		size_t GetMaxFrame() const { return maxFrame_; };
+		IngressStats GetStats() const;
+	private:
+		void Refill(int64_t now);
+		Verdict Strike(int64_t now);
+
+		size_t maxFrame_;
+		double messageRate_;
+		double byteRate_;
+		int throttleAfter_;
+		int kickAfter_;
+
+		double messageTokens_;
+		double byteTokens_;
+		int64_t refilledAt_;
+
+		int strikes_;
+		int64_t windowStart_;
+		int64_t throttledUntil_;
+
+		// Read by the lobby while the client thread counts
+		std::atomic<uint64_t> accepted_;
+		std::atomic<uint64_t> oversized_;
+		std::atomic<uint64_t> limited_;
+		std::atomic<uint64_t> throttles_;
+	};
+
+}
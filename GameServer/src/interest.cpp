@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "interest.h"
+
+size_t hgs::ReadPosition(const std::string& frame, Position& position) {
+	// Typed headers are read at fixed offsets, nothing is parsed
+	uint32_t schema = 0;
+	const size_t fieldsAt = schema::ReadHeader(frame, 0, schema);
+	if (fieldsAt > 0 && schema == PositionSchema::GetId()) {
+		Position typed;
+		if (!PositionSchema::Get<0>(frame, fieldsAt, typed.x) || !PositionSchema::Get<1>(frame, fieldsAt, typed.y)) return 0;
+		position = typed;
+		return fieldsAt + PositionSchema::Width();
+	}
+
+	if (frame.compare(0, 3, positionHeader) != 0) return 0;
+
+	const char* start = frame.c_str() + 3;
+	char* end = nullptr;
+	const float x = std::strtof(start, &end);
+	if (end == start || *end != ',') return 0;
+
+	start = end + 1;
+	const float y = std::strtof(start, &end);
+	if (end == start || *end != '@') return 0;
+
+	if (!std::isfinite(x) || !std::isfinite(y)) return 0;
+
+	position.x = x;
+	position.y = y;
+	return static_cast<size_t>(end - frame.c_str()) + 1;
+}
+
+hgs::InterestGrid::InterestGrid(const float cell_size, const float radius) : cellSize_(cell_size > 0.0f ? cell_size : 1.0f), radius_(0.0f), reach_(0), placed_(0) {
+	SetRadius(radius);
+}
+
+void hgs::InterestGrid::Move(const int slot, const Position position) {
+	if (slot < 0) return;
+	if (static_cast<size_t>(slot) >= members_.size()) {
+		members_.resize(static_cast<size_t>(slot) + 1);
+	}
+
+	Member& member = members_[static_cast<size_t>(slot)];
+	const int32_t cellX = CellOf(position.x);
+	const int32_t cellY = CellOf(position.y);
+	member.position = position;
+
+	if (member.placed) {
+		if (member.cellX == cellX && member.cellY == cellY) return;
+		Unlink(member, slot);
+	} else {
+		member.placed = true;
+		placed_++;
+	}
+
+	member.cellX = cellX;
+	member.cellY = cellY;
+	cells_[Key(cellX, cellY)].push_back(slot);
+}
+
+void hgs::InterestGrid::Remove(const int slot) {
+	if (!IsPlaced(slot)) return;
+
+	Member& member = members_[static_cast<size_t>(slot)];
+	Unlink(member, slot);
+	member.placed = false;
+	placed_--;
+}
+
+void hgs::InterestGrid::Clear() {
+	members_.clear();
+	cells_.clear();
+	frames_.clear();
+	next_.clear();
+	global_.clear();
+	placed_ = 0;
+}
+
+void hgs::InterestGrid::Index(std::vector<Message>& queue) {
+	std::fill(frames_.begin(), frames_.end(), -1);
+	if (frames_.size() < members_.size()) {
+		frames_.resize(members_.size(), -1);
+	}
+	global_.clear();
+	next_.assign(queue.size(), -1);
+
+	// Walked backwards so every chain of frames is in queue order
+	for (size_t i = queue.size(); i > 0; i--) {
+		Message& message = queue[i - 1];
+		// Addressed frames reach their targets at any distance
+		message.local = IsPlaced(message.slot) && message.targets.empty();
+		if (message.local) {
+			next_[i - 1] = frames_[static_cast<size_t>(message.slot)];
+			frames_[static_cast<size_t>(message.slot)] = static_cast<int>(i - 1);
+		} else {
+			global_.push_back(i - 1);
+		}
+	}
+	std::reverse(global_.begin(), global_.end());
+}
+
+void hgs::InterestGrid::Query(const int slot, std::vector<int>& slots) const {
+	slots.clear();
+	if (!IsPlaced(slot)) return;
+
+	const Member& center = members_[static_cast<size_t>(slot)];
+	const float radius2 = radius_ * radius_;
+
+	// A radius that spans more cells than are occupied walks the occupied ones
+	const uint64_t side = 2 * static_cast<uint64_t>(reach_) + 1;
+	if (side * side > cells_.size()) {
+		for (auto& cell : cells_) {
+			for (int other : cell.second) {
+				const Position& position = members_[static_cast<size_t>(other)].position;
+				const float dx = position.x - center.position.x;
+				const float dy = position.y - center.position.y;
+				if (dx * dx + dy * dy <= radius2) {
+					slots.push_back(other);
+				}
+			}
+		}
+		return;
+	}
+
+	for (int64_t x = int64_t(center.cellX) - reach_; x <= int64_t(center.cellX) + reach_; x++) {
+		for (int64_t y = int64_t(center.cellY) - reach_; y <= int64_t(center.cellY) + reach_; y++) {
+			const auto cell = cells_.find(Key(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+			if (cell == cells_.end()) continue;
+
+			for (int other : cell->second) {
+				const Position& position = members_[static_cast<size_t>(other)].position;
+				const float dx = position.x - center.position.x;
+				const float dy = position.y - center.position.y;
+				if (dx * dx + dy * dy <= radius2) {
+					slots.push_back(other);
+				}
+			}
+		}
+	}
+}
+
+void hgs::InterestGrid::SetRadius(const float radius) {
+	// NaN turns the filter off like 0
+	radius_ = radius > 0.0f ? radius : 0.0f;
+	// Cells only span [-1e9, 1e9], a reach past that covers all of them
+	reach_ = static_cast<int32_t>(std::min(std::ceil(static_cast<double>(radius_) / cellSize_), static_cast<double>(maxReach)));
+	if (!IsEnabled()) {
+		Clear();
+	}
+}
+
+int32_t hgs::InterestGrid::CellOf(const float coordinate) const {
+	// Far away positions share the border cells instead of overflowing
+	const double cell = std::floor(static_cast<double>(coordinate) / cellSize_);
+	return static_cast<int32_t>(std::min(std::max(cell, -1e9), 1e9));
+}
+
+void hgs::InterestGrid::Unlink(const Member& member, const int slot) {
+	const auto cell = cells_.find(Key(member.cellX, member.cellY));
+	if (cell == cells_.end()) return;
+
+	std::vector<int>& slots = cell->second;
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slots[i] == slot) {
+			slots[i] = slots.back();
+			slots.pop_back();
+			break;
+		}
+	}
+	if (slots.empty()) {
+		cells_.erase(cell);
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "pch.h"
+#include "message.h"
+#include "schema.h"
+
+/**
+	Interest.h
+	Purpose: Area of interest filtering inside a lobby. Clients report
+	a position and only get the frames of senders within the interest
+	radius, found through a uniform grid of cells
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// Frames carrying a position start with a header: "{id|@p=x,y@payload}",
+	// a channel header may follow it
+	constexpr char positionHeader[] = "@p=";
+
+	struct Position {
+		float x = 0.0f;
+		float y = 0.0f;
+	};
+
+	/**
+		Read the position header at the start of a frame,
+		in text or as a PositionSchema header
+
+		@param frame Payload as sent by the client
+		@param position Filled in if the header is valid
+		@return size_t Offset of the first character after the header,
+		0 if the frame has no valid header
+	 */
+	size_t ReadPosition(const std::string& frame, Position& position);
+
+	/**
+		The lobby thread moves clients while it collects the
+		frames of the receive phase and indexes the frames when
+		the send phase starts. Client threads only query during
+		the send phase, so no lock is needed
+	 */
+	class InterestGrid {
+	public:
+		// Largest reach in cells, wide enough to cover every cell
+		static constexpr int32_t maxReach = 2000000000;
+
+		InterestGrid(float cell_size, float radius);
+		/**
+			Place a slot or move it, the slot only changes
+			cell lists when it crosses a cell border
+
+			@param slot Slot of the client in the lobby
+			@param position Reported position
+			@return void
+		 */
+		void Move(int slot, Position position);
+		/**
+			Take a slot off the grid, its frames
+			go to everyone again
+
+			@param slot Slot of the client in the lobby
+			@return void
+		 */
+		void Remove(int slot);
+		/**
+			Take every slot off the grid
+
+			@return void
+		 */
+		void Clear();
+		/**
+			Mark the unaddressed frames of placed senders as local
+			and index them by slot, every other frame is global.
+			A slot may send several frames in one tick
+
+			@param queue Frames of the tick
+			@return void
+		 */
+		void Index(std::vector<Message>& queue);
+		/**
+			Collect the placed slots within the interest
+			radius of a slot, the slot itself included
+
+			@param slot Placed slot
+			@param slots Cleared and filled with the result
+			@return void
+		 */
+		void Query(int slot, std::vector<int>& slots) const;
+		/**
+			Change the interest radius, 0 turns the filter off
+			and takes every slot off the grid
+
+			@param radius World units
+			@return void
+		 */
+		void SetRadius(float radius);
+
+		bool IsEnabled() const { return radius_ > 0.0f; };
+		bool IsPlaced(const int slot) const {
+			return slot >= 0 && static_cast<size_t>(slot) < members_.size() && members_[static_cast<size_t>(slot)].placed;
+		};
+		// Index in the queue of the first frame a slot sent this tick, -1 for none
+		int GetFrame(const int slot) const {
+			return static_cast<size_t>(slot) < frames_.size() ? frames_[static_cast<size_t>(slot)] : -1;
+		};
+		// Index of the next frame of the same slot, -1 after the last
+		int GetNext(const int frame) const {
+			return static_cast<size_t>(frame) < next_.size() ? next_[static_cast<size_t>(frame)] : -1;
+		};
+		const std::vector<size_t>& GetGlobal() const { return global_; };
+		float GetRadius() const { return radius_; };
+		float GetCellSize() const { return cellSize_; };
+		size_t GetPlaced() const { return placed_; };
+	private:
+		struct Member {
+			Position position;
+			int32_t cellX = 0;
+			int32_t cellY = 0;
+			bool placed = false;
+		};
+
+		int32_t CellOf(float coordinate) const;
+		static uint64_t Key(int32_t x, int32_t y) { return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y); };
+		void Unlink(const Member& member, int slot);
+
+		const float cellSize_;
+		float radius_;
+		// Cells checked in every direction around the querying cell
+		int32_t reach_;
+
+		std::vector<Member> members_;
+		size_t placed_;
+		// Slots in every occupied cell
+		std::unordered_map<uint64_t, std::vector<int>> cells_;
+
+		// Per tick index of the queue
+		std::vector<int> frames_;
+		std::vector<int> next_;
+		std::vector<size_t> global_;
+	};
+
+}
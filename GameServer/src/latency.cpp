@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "latency.h"
+
+namespace {
+	const char* stageNames[hgs::stage_count] = {
+		"recv", "decode", "enqueue", "pickup", "build", "send"
+	};
+}
+
+hgs::LatencyHistogram::LatencyHistogram() {
+	Reset();
+}
+
+void hgs::LatencyHistogram::Add(const Stage stage, int64_t microseconds) {
+	if (microseconds < 0) microseconds = 0;
+
+	// Index of the highest set bit decides the bucket
+	int bucket = 0;
+	while (bucket < bucketCount - 1 && (microseconds >> bucket) != 0) {
+		bucket++;
+	}
+
+	buckets_[stage][bucket].fetch_add(1, std::memory_order_relaxed);
+	count_[stage].fetch_add(1, std::memory_order_relaxed);
+
+	int64_t previous = max_[stage].load(std::memory_order_relaxed);
+	while (previous < microseconds && !max_[stage].compare_exchange_weak(previous, microseconds, std::memory_order_relaxed)) {}
+}
+
+void hgs::LatencyHistogram::Add(const LatencyStamps& stamps, const Stage stage) {
+	if (stage == stage_recv) return;
+	Add(stage, stamps.at[stage] - stamps.at[stage - 1]);
+}
+
+void hgs::LatencyHistogram::Reset() {
+	for (int stage = 0; stage < stage_count; stage++) {
+		for (auto& bucket : buckets_[stage]) {
+			bucket = 0;
+		}
+		count_[stage] = 0;
+		max_[stage] = 0;
+	}
+}
+
+std::string hgs::LatencyHistogram::List() const {
+	std::string result = "\n===== Message latency =====\n(microseconds spent since the previous stage)";
+	// The recv stamp is the start of the pipeline, it has no duration of its own
+	for (int stage = stage_decode; stage < stage_count; stage++) {
+		const Stage current = static_cast<Stage>(stage);
+		result.append("\n" + std::string(stageNames[stage]) +
+			": count " + std::to_string(count_[stage].load()) +
+			" p50 " + std::to_string(Percentile(current, 0.50)) +
+			" p99 " + std::to_string(Percentile(current, 0.99)) +
+			" max " + std::to_string(max_[stage].load()));
+	}
+	result.append("\n===========================");
+	return result;
+}
+
+int64_t hgs::LatencyHistogram::Percentile(const Stage stage, const double percentile) const {
+	const uint64_t count = count_[stage].load();
+	if (count == 0) return 0;
+
+	const uint64_t target = static_cast<uint64_t>(percentile * static_cast<double>(count - 1)) + 1;
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < bucketCount; bucket++) {
+		seen += buckets_[stage][bucket].load();
+		if (seen >= target) {
+			return bucket == 0 ? 0 : (int64_t(1) << bucket) - 1;
+		}
+	}
+	return max_[stage].load();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "message.h"
+
+/**
+	Latency.h
+	Purpose: Aggregates the per-stage timestamps of sampled messages
+	into log2 histograms, one histogram per pipeline stage
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	class LatencyHistogram {
+	public:
+		// Bucket i holds samples in [2^(i-1), 2^i) microseconds, bucket 0 holds 0
+		static constexpr int bucketCount = 32;
+
+		LatencyHistogram();
+		/**
+			Add the time a message spent in
+			a stage to the histogram
+
+			@param stage The stage that just finished
+			@param microseconds Time spent since the previous stage
+			@return void
+		 */
+		void Add(Stage stage, int64_t microseconds);
+		/**
+			Add the time between two consecutive
+			stamps of a sampled message
+
+			@param stamps Stamps of the message
+			@param stage The stage that just finished
+			@return void
+		 */
+		void Add(const LatencyStamps& stamps, Stage stage);
+		/**
+			Clear all samples
+
+			@return void
+		 */
+		void Reset();
+		/**
+			Composes a table with count, p50, p99
+			and max of every stage
+
+			@return std::string
+		 */
+		std::string List() const;
+	private:
+		/**
+			Upper bound of the bucket containing
+			the requested percentile
+
+			@return int64_t Microseconds
+		 */
+		int64_t Percentile(Stage stage, double percentile) const;
+
+		std::array<std::array<std::atomic<uint64_t>, bucketCount>, stage_count> buckets_;
+		std::array<std::atomic<uint64_t>, stage_count> count_;
+		std::array<std::atomic<int64_t>, stage_count> max_;
+	};
+
+}
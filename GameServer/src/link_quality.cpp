@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "link_quality.h"
+
+double hgs::LinkStats::Loss() const {
+	const uint64_t settled = received + lost;
+	if (settled == 0) return 0.0;
+	return static_cast<double>(lost) / static_cast<double>(settled);
+}
+
+std::string hgs::LinkStats::ToString() const {
+	if (!HasSamples()) {
+		return "rtt - jitter - loss " + std::to_string(static_cast<int>(Loss() * 100.0)) + "%";
+	}
+	char buffer[96];
+	snprintf(buffer, sizeof(buffer), "rtt %.1fms jitter %.1fms loss %.1f%%",
+		static_cast<double>(rtt) / 1000.0,
+		static_cast<double>(jitter) / 1000.0,
+		Loss() * 100.0);
+	return buffer;
+}
+
+hgs::LinkQuality::LinkQuality() = default;
+
+void hgs::LinkQuality::OnPing(const uint32_t sequence, const int64_t now, const int64_t timeout) {
+	std::lock_guard<std::mutex> lock(statsMtx_);
+
+	// Expire pings that were never answered
+	for (auto& ping : outstanding_) {
+		if (ping.waiting && now - ping.sentAt >= timeout) {
+			ping.waiting = false;
+			stats_.lost++;
+		}
+	}
+
+	Outstanding& slot = outstanding_[sequence % maxOutstanding];
+	// The slot is reused before its ping was answered
+	if (slot.waiting) {
+		stats_.lost++;
+	}
+	slot.sequence = sequence;
+	slot.sentAt = now;
+	slot.waiting = true;
+	stats_.sent++;
+}
+
+bool hgs::LinkQuality::OnPong(const uint32_t sequence, const int64_t now) {
+	std::lock_guard<std::mutex> lock(statsMtx_);
+
+	Outstanding& slot = outstanding_[sequence % maxOutstanding];
+	if (!slot.waiting || slot.sequence != sequence) {
+		return false;
+	}
+	slot.waiting = false;
+
+	const int64_t sample = std::max<int64_t>(now - slot.sentAt, 0);
+
+	if (stats_.received == 0) {
+		stats_.rtt = sample;
+		stats_.jitter = sample / 2;
+		stats_.minRtt = sample;
+	} else {
+		// Same smoothing as TCP (RFC 6298) for the round trip and
+		// RFC 3550 for the interarrival jitter
+		stats_.rtt += (sample - stats_.rtt) / 8;
+		const int64_t deviation = std::abs(sample - stats_.lastRtt);
+		stats_.jitter += (deviation - stats_.jitter) / 16;
+		stats_.minRtt = std::min(stats_.minRtt, sample);
+	}
+	stats_.lastRtt = sample;
+	stats_.received++;
+	return true;
+}
+
+hgs::LinkStats hgs::LinkQuality::GetStats() const {
+	std::lock_guard<std::mutex> lock(statsMtx_);
+	return stats_;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "pch.h"
+
+/**
+	LinkQuality.h
+	Purpose: Tracks round trip time, jitter and loss of one client
+	connection from the server's ping/pong control frames
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	struct LinkStats {
+		// Smoothed round trip time in microseconds, 0 until the first pong
+		int64_t rtt = 0;
+		// Mean deviation between consecutive round trips in microseconds
+		int64_t jitter = 0;
+		int64_t lastRtt = 0;
+		int64_t minRtt = 0;
+		uint64_t sent = 0;
+		uint64_t received = 0;
+		uint64_t lost = 0;
+
+		bool HasSamples() const { return received > 0; };
+		/**
+			Share of pings that were never answered
+			within the timeout
+
+			@return double Between 0 and 1
+		 */
+		double Loss() const;
+		/**
+			Compose a single line summary, used
+			by lobby listings
+
+			@return std::string
+		 */
+		std::string ToString() const;
+	};
+
+	class LinkQuality {
+	public:
+		// Pings awaiting a pong at the same time
+		static constexpr size_t maxOutstanding = 16;
+
+		LinkQuality();
+		/**
+			Register a ping that has just been sent,
+			pings older than the timeout are counted as lost
+
+			@param sequence Sequence number of the ping
+			@param now Send time in microseconds
+			@param timeout Microseconds before an unanswered ping is lost
+			@return void
+		 */
+		void OnPing(uint32_t sequence, int64_t now, int64_t timeout);
+		/**
+			Register the pong of an earlier ping and
+			update the round trip estimates
+
+			@param sequence Sequence number echoed by the client
+			@param now Receive time in microseconds
+			@return bool False if the ping was unknown or already expired
+		 */
+		bool OnPong(uint32_t sequence, int64_t now);
+
+		// Getters
+		LinkStats GetStats() const;
+	private:
+		struct Outstanding {
+			uint32_t sequence = 0;
+			int64_t sentAt = 0;
+			bool waiting = false;
+		};
+
+		std::array<Outstanding, maxOutstanding> outstanding_;
+		LinkStats stats_;
+
+		mutable std::mutex statsMtx_;
+	};
+
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "lobby.h"
+#include "trace.h"
 
 hgs::SharedLobbyMemory::SharedLobbyMemory(const int id, Lobby* parent) : id_(id), parent_(parent){
 	state_ = none;
@@ -52,14 +53,19 @@ void hgs::SharedLobbyMemory::SetPauseState(const int pre_pause) {
 	}
 }
 
-hgs::Lobby::Lobby(const int id, std::string& name_tag, const gsl::not_null <SharedMemory*> shared_memory, Configuration* conf) : conf_(conf), sharedMemory_(shared_memory), id_(id), nameTag_(name_tag) {
+hgs::Lobby::Lobby(const int id, std::string& name_tag, const gsl::not_null <SharedMemory*> shared_memory, Configuration* conf) :
+conf_(conf), channels_(static_cast<size_t>(std::max(conf->lobbyMaxChannels, 0))), interest_(conf->interestCellSize, conf->interestRadius),
+snapshot_(static_cast<size_t>(std::max(conf->snapshotTicks, 0))), store_(static_cast<size_t>(std::max(conf->storeMaxKeys, 0))), sharedMemory_(shared_memory), id_(id), nameTag_(name_tag) {
 	//lobbyState_ = none;
 	internalState_ = none;
 	coreCallPerformedCount_ = 0;
 	connectedClients_ = 0;
 	commandQueue_.clear();
+	coalesced_ = 0;
 
 	running_ = true;
+	executing_ = false;
+	clock_ = &sharedMemory_->GetClock();
 	sharedLobbyMemory_ = new SharedLobbyMemory(id_, this);
 
 	// Setup lobby logger
@@ -107,8 +113,17 @@ void hgs::Lobby::CleanUp() {
 	spdlog::drop("SessionLog#" + (!nameTag_.empty() ? nameTag_ : std::to_string(id_)));
 }
 
+void hgs::Lobby::Start() {
+	executing_ = true;
+
+	std::thread lobbyThread(&Lobby::Execute, this);
+	lobbyThread.detach();
+}
+
 void hgs::Lobby::Execute() {
 
+	trace::SetThreadName("Lobby#" + (!nameTag_.empty() ? nameTag_ : std::to_string(id_)));
+
 	while (running_) {
 
 		switch (sharedLobbyMemory_->GetPauseState()) {
@@ -123,7 +138,7 @@ void hgs::Lobby::Execute() {
 			break;
 		}
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(conf_->clockSpeed));
+		clock_->Sleep(std::chrono::milliseconds(conf_->clockSpeed));
 	}
 	CleanUp();
 
@@ -132,16 +147,23 @@ void hgs::Lobby::Execute() {
 
 void hgs::Lobby::Loop() {
 
-	DropAwaiting();
+	HGS_TRACE_SCOPE("Lobby::Loop", id_);
+
+	{
+		HGS_TRACE_SCOPE("DropAwaiting", id_);
+		DropAwaiting();
+	}
 
 	if (connectedClients_ > 0) {
 
 		// Receiving state
 		if (internalState_ == State::receiving) {
+			HGS_TRACE_SCOPE("ReceivePhase", id_);
 			InitializeReceiving();
 		}
 		// Sending state
 		else if (internalState_ == State::sending) {
+			HGS_TRACE_SCOPE("SendPhase", id_);
 			InitializeSending();
 		}
 	}
@@ -162,12 +184,46 @@ void hgs::Lobby::Loop() {
 
 void hgs::Lobby::InitializeSending() {
 
+	// Sampled messages are picked up by this tick
+	const int64_t pickedUpAt = clock_->Now();
+	for (auto& message : commandQueue_) {
+		if (message.stamps != nullptr) {
+			message.stamps->at[stage_pickup] = pickedUpAt;
+
+			LatencyHistogram& latency = sharedMemory_->GetLatency();
+			latency.Add(*message.stamps, stage_decode);
+			latency.Add(*message.stamps, stage_enqueue);
+			latency.Add(*message.stamps, stage_pickup);
+		}
+	}
+
+	// Server frame, so never delta encoded or recorded in the snapshot
+	Message changes;
+	if (store_.Flush(changes.frame)) {
+		commandQueue_.push_back(changes);
+	}
+
+	if (interest_.IsEnabled()) {
+		HGS_TRACE_SCOPE("InterestIndex", id_);
+		interest_.Index(commandQueue_);
+	}
+
+	if (conf_->snapshotEnable) {
+		HGS_TRACE_SCOPE("SnapshotRecord", id_);
+		snapshot_.Record(commandQueue_);
+	}
+
+	const std::shared_ptr<const std::string> compressed = CompressQueue();
+
 	// Iterate through all clients
 	Client* current = firstClient_;
 	while (current != nullptr) {
 
 		// Give client data
 		current->SetOutgoing(commandQueue_);
+		if (compressed != nullptr && current->IsCompressing()) {
+			current->SetCompressed(compressed);
+		}
 
 		current = current->next;
 	}
@@ -178,7 +234,8 @@ void hgs::Lobby::InitializeSending() {
 	int readyClients = 0;
 
 	// Check if all clients have sent
-	for (int i = 0; i < conf_->timeoutTries; i++) {
+	const int timeoutTries = TimeoutTries();
+	for (int i = 0; i < timeoutTries; i++) {
 		// Iterate through all clients
 		current = firstClient_;
 		while (current != nullptr) {
@@ -196,7 +253,7 @@ void hgs::Lobby::InitializeSending() {
 		}
 
 		// Sleep for half a millisecond, convert milliseconds to microseconds
-		std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int>(conf_->timeoutDelay * 1000)));
+		clock_->Sleep(std::chrono::microseconds(static_cast<int>(conf_->timeoutDelay * 1000)));
 	}
 
 	DropNonResponding(State::done_sending);
@@ -213,7 +270,8 @@ void hgs::Lobby::InitializeReceiving() {
 
 	int readyClients = 0;
 
-	for (int i = 0; i < conf_->timeoutTries; i++) {
+	const int timeoutTries = TimeoutTries();
+	for (int i = 0; i < timeoutTries; i++) {
 		// Iterate through all clients
 		Client* current = firstClient_;
 		while (current != nullptr) {
@@ -221,14 +279,29 @@ void hgs::Lobby::InitializeReceiving() {
 			// If client has received response then take it
 			if (current->GetState() == State::received) {
 				current->SetState(State::done_receiving);
-				if (!current->GetCommand().empty()) {
-					commandQueue_.push_back(current->GetCommand());
+				if (current->HasMoved() && interest_.IsEnabled()) {
+					interest_.Move(current->GetSlot(), current->GetPosition());
+				}
+				if (!current->GetMutations().empty()) {
+					ApplyMutations(current);
+				}
+				// Frames of one client are queued back to back
+				const size_t first = commandQueue_.size();
+				for (Message& message : current->GetReceived()) {
+					if (message.stamps != nullptr) {
+						message.stamps->at[stage_enqueue] = clock_->Now();
+					}
 
 					// Create log if enabled
 					if (sessionLog_ != nullptr) {
-						sessionLog_->info("Client#" + std::to_string(current->id) + " " + current->GetCommand());
-					}	
+						sessionLog_->info("Client#" + std::to_string(current->id) + " " + message.frame);
+					}
+
+					if (!conf_->lobbyCoalesce || !Coalesce(message, first)) {
+						commandQueue_.push_back(std::move(message));
+					}
 				}
+				current->GetReceived().clear();
 				readyClients++;
 			}
 
@@ -240,7 +313,7 @@ void hgs::Lobby::InitializeReceiving() {
 		}
 
 		// Sleep for half a millisecond, convert milliseconds to microseconds
-		std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int>(conf_->timeoutDelay * 1000)));
+		clock_->Sleep(std::chrono::microseconds(static_cast<int>(conf_->timeoutDelay * 1000)));
 	}
 
 	DropNonResponding(State::done_receiving);
@@ -253,6 +326,21 @@ void hgs::Lobby::InitializeReceiving() {
 	}
 }
 
+bool hgs::Lobby::Coalesce(Message& message, const size_t first) {
+	// Only frames marked as state are superseded, events and addressed frames all arrive
+	if (!message.state || !message.targets.empty()) return false;
+
+	for (size_t i = first; i < commandQueue_.size(); i++) {
+		Message& queued = commandQueue_[i];
+		if (queued.sender == message.sender && queued.channel == message.channel && queued.state && queued.targets.empty()) {
+			queued = std::move(message);
+			coalesced_++;
+			return true;
+		}
+	}
+	return false;
+}
+
 void hgs::Lobby::DropNonResponding(const State non_condition_state) {
 	// Kick non responding clients (all clients which are not ready at this point)
 	Client* current = (firstClient_ == nullptr ? nullptr : firstClient_);
@@ -299,6 +387,11 @@ void hgs::Lobby::WaitForPause(const State perform_on_state) const {
 }
 
 void hgs::Lobby::WaitForPause() const {
+	// Nothing to pause when no thread runs the loop
+	if (!executing_) return;
+
+	HGS_TRACE_SCOPE("WaitForPause", id_);
+
 	// Send pause request to lobby loop
 	sharedLobbyMemory_->SetPauseState(1);
 
@@ -319,9 +412,38 @@ std::string hgs::Lobby::List() const {
 	// Composer list of clients
 	Client* current = firstClient_;
 	while (current != nullptr) {
-		result.append("\nClient#" + std::to_string(current->id));
+		result.append("\nClient#" + std::to_string(current->id) + " " + current->GetLinkStats().ToString());
+		if (current->IsDeltaEnabled()) {
+			result.append(" delta saved " + std::to_string(static_cast<int>(current->GetDeltaSavings() * 100.0)) + "%");
+		}
+		if (current->IsReliable()) {
+			result.append(" reliable rto " + std::to_string(current->GetReliableRto() / 1000) + " ms, " + std::to_string(current->GetRetransmits()) + " resent");
+		}
+		if (current->GetSendInterval() > 1) {
+			result.append(" every " + std::to_string(current->GetSendInterval()) + " ticks, " + std::to_string(current->GetThroughput() / 1000) + " kB/s");
+		}
+		if (current->IsIngressLimited()) {
+			const IngressStats ingress = current->GetIngressStats();
+			if (ingress.Rejected() > 0) {
+				result.append(" rejected " + std::to_string(ingress.Rejected()) + " (" + std::to_string(ingress.oversized) + " oversized), throttled " + std::to_string(ingress.throttles) + " times");
+			}
+		}
+		if (current->IsSuspended()) {
+			result.append(" suspended");
+		}
 		current = current->next;
 	}
+
+	if (conf_->lobbyCoalesce) {
+		result.append("\n" + std::to_string(coalesced_) + " superseded frames coalesced");
+	}
+	if (interest_.IsEnabled()) {
+		result.append("\nInterest radius " + std::to_string(static_cast<int>(interest_.GetRadius())) + ", " + std::to_string(interest_.GetPlaced()) + " placed clients");
+	}
+	result.append(channels_.List());
+	if (store_.IsEnabled()) {
+		result.append(store_.List());
+	}
 	
 	result.append("\n===========================");
 
@@ -330,6 +452,95 @@ std::string hgs::Lobby::List() const {
 	return result;
 }
 
+int hgs::Lobby::TimeoutTries() const {
+	if (!conf_->lobbyAdaptiveTimeout || conf_->timeoutDelay <= 0) {
+		return conf_->timeoutTries;
+	}
+
+	const int64_t worst = WorstLink();
+	if (worst == 0) {
+		return conf_->timeoutTries;
+	}
+
+	// Give the slowest client two round trips, never less than configured
+	const double budgetMs = static_cast<double>(worst * 2) / 1000.0;
+	const int tries = static_cast<int>(std::ceil(budgetMs / conf_->timeoutDelay));
+	return std::max(tries, conf_->timeoutTries);
+}
+
+int64_t hgs::Lobby::WorstLink() const {
+	int64_t worst = 0;
+
+	Client* current = firstClient_;
+	while (current != nullptr) {
+		const LinkStats stats = current->GetLinkStats();
+		if (stats.HasSamples()) {
+			worst = std::max(worst, stats.rtt + 4 * stats.jitter);
+		}
+		current = current->next;
+	}
+	return worst;
+}
+
+void hgs::Lobby::ApplyMutations(Client* client) {
+	HGS_TRACE_SCOPE("StoreApply", id_);
+
+	for (auto& mutation : client->GetMutations()) {
+		const std::string error = store_.Apply(mutation);
+		if (!error.empty()) {
+			Message reply;
+			reply.frame = "{#|" + error + "}";
+			reply.targets.push_back(client->id);
+			commandQueue_.push_back(reply);
+		}
+	}
+	client->GetMutations().clear();
+}
+
+std::shared_ptr<const std::string> hgs::Lobby::CompressQueue() const {
+	if (!conf_->compressionEnable) {
+		return nullptr;
+	}
+
+	bool compressing = false;
+	Client* current = firstClient_;
+	while (current != nullptr && !compressing) {
+		compressing = current->IsCompressing();
+		current = current->next;
+	}
+	if (!compressing) {
+		return nullptr;
+	}
+
+	// Sampled frames are stamped per recipient, channel, local and
+	// addressed frames have their own recipients, all of them stay out
+	std::string frames;
+	for (auto& message : commandQueue_) {
+		if (message.IsShared()) {
+			frames.append(message.frame);
+		}
+	}
+	if (frames.empty() || static_cast<int>(frames.size()) < conf_->compressionThreshold) {
+		return nullptr;
+	}
+
+	HGS_TRACE_SCOPE("Lobby::CompressQueue", id_);
+	std::string compressed;
+	sharedMemory_->GetCompressor().Compress(frames.data(), frames.size(), compressed);
+	compressed.insert(compressed.begin(), compressedMarker);
+	return std::make_shared<const std::string>(std::move(compressed));
+}
+
+void hgs::Lobby::SetInterestRadius(const float radius) {
+	// Client threads query the grid while sending
+	WaitForPause();
+
+	interest_.SetRadius(radius);
+
+	// Continue lobby loop
+	sharedLobbyMemory_->SetPauseState(0);
+}
+
 hgs::Client* hgs::Lobby::FindClient(const int id) const {
 	Client* current = firstClient_;
 
@@ -353,8 +564,18 @@ int hgs::Lobby::AddClient(Client* client, const bool respect_limit, const bool e
 	// Pause the lobby
 	WaitForPause();
 
+	// Composed while the lobby is idle, a tick recorded or a store change
+	// flushed after the snapshot would otherwise only reach the existing
+	// clients. The store goes first so replayed frames see the current state
+	std::string snapshot = store_.Compose();
+	if (conf_->snapshotEnable) {
+		snapshot.append(snapshot_.Compose());
+	}
+	client->SetSnapshot(snapshot);
+
 	// Give the client a pointer to the lobby memory
 	client->SetMemory(sharedLobbyMemory_);
+	client->SetSlot(channels_.AddMember());
 	client->lobbyId = this->id_;
 	client->SetState(none);
 	client->SetPrevState((this->internalState_ == State::sending ? State::received : State::sending));
@@ -428,8 +649,21 @@ hgs::Client* hgs::Lobby::DropClient(Client* client, const bool detach_only, cons
 	connectedClients_--;
 	log_->info("Dropped client #" + std::to_string(client->id));
 
+	// Subscriptions and positions don't follow the client to another lobby
+	interest_.Remove(client->GetSlot());
+	channels_.RemoveMember(client->GetSlot());
+	snapshot_.Forget(client->id);
+	client->GetMutations().clear();
+	client->GetReceived().clear();
+	client->SetSlot(-1);
+
 	// Tell other clients that this client has disconnected
-	commandQueue_.push_back("{" + std::to_string(client->id) + "|D}");
+	if (!client->HasHandedOver()) {
+		Message disconnect;
+		disconnect.sender = client->id;
+		disconnect.frame = "{" + std::to_string(client->id) + "|D}";
+		commandQueue_.push_back(disconnect);
+	}
 
 	if (detach_only) {
 
@@ -437,7 +671,9 @@ hgs::Client* hgs::Lobby::DropClient(Client* client, const bool detach_only, cons
 
 		client->SetPrevState(none);
 		client->SetState(none);
-		std::vector<std::string> outgoing = { "{*|D}" };
+		Message dropAll;
+		dropAll.frame = "{*|D}";
+		std::vector<Message> outgoing = { dropAll };
 		// Tell client to drop all already existing externals
 		client->SetOutgoing(outgoing);
 		client->Send();
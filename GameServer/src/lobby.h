@@ -2,6 +2,12 @@
 #include "shared_memory.h"
 #include "client.h"
 #include "utilities.h"
+#include "message.h"
+#include "clock.h"
+#include "channels.h"
+#include "interest.h"
+#include "snapshot.h"
+#include "store.h"
 
 /**
 	Lobby.h
@@ -75,6 +81,13 @@ namespace hgs {
 			@return void
 		 */
 		void CleanUp();
+		/**
+			Release the lobby to a new detached
+			thread running Execute
+
+			@return void
+		 */
+		void Start();
 		/**
 			Method is the main loop for the lobby.
 			It calls the loop method every iteration
@@ -113,6 +126,16 @@ namespace hgs {
 			@return void
 		 */
 		void DropNonResponding(State non_condition_state);
+		/**
+			Replace an earlier frame marked as state of the same
+			sender and channel in this tick, so superseded
+			state is never fanned out
+
+			@param message Frame to queue, moved from if it replaced one
+			@param first Index of the first queued frame of the sender
+			@return bool True if the frame took the place of an earlier one
+		 */
+		bool Coalesce(Message& message, size_t first);
 		/**
 			Broadcasts the call from lobby
 			to all clients
@@ -137,6 +160,48 @@ namespace hgs {
 			@return void
 		 */
 		std::string List() const;
+		/**
+			Number of timeout_delay polls the lobby waits for
+			its clients each phase. With adaptive timeouts the
+			budget grows to cover the slowest measured link
+
+			@return int
+		 */
+		int TimeoutTries() const;
+		/**
+			The worst smoothed round trip plus jitter
+			among the clients of the lobby
+
+			@return int64_t Microseconds, 0 if no client has been measured
+		 */
+		int64_t WorstLink() const;
+		/**
+			Compress the unsampled frames of the tick once
+			for every client that negotiated compression. The
+			result holds the recipient's own frame as well
+
+			@return std::shared_ptr<const std::string> Marker and compressed
+			frames, nullptr when no client compresses or the frames are
+			below the threshold
+		 */
+		std::shared_ptr<const std::string> CompressQueue() const;
+		/**
+			Apply the store mutations a client sent this tick,
+			rejected ones are answered with a frame addressed
+			to the client alone
+
+			@param client Client that has received
+			@return void
+		 */
+		void ApplyMutations(Client* client);
+		/**
+			Change the interest radius of the lobby,
+			0 sends every frame to everyone again
+
+			@param radius World units
+			@return void
+		 */
+		void SetInterestRadius(float radius);
 		/**
 			Iterate through the lobby to try to find if a specific client
 			is withing it
@@ -203,16 +268,24 @@ namespace hgs {
 		int DropAll();
 
 		// Getters
-		std::vector<std::string> GetClientCommands() const { return commandQueue_; };
+		std::vector<Message> GetClientCommands() const { return commandQueue_; };
 		int GetConnectedClients() const { return connectedClients_; };
 		int GetId() const { return id_; };
 		std::string GetNameTag() const { return nameTag_; };
+		ChannelTable& GetChannels() { return channels_; };
+		// Nullptr when the lobby doesn't filter by interest
+		const InterestGrid* GetInterest() const { return interest_.IsEnabled() ? &interest_ : nullptr; };
 	private:
 		bool running_;
+		// Set when Start hands the loop to its own thread. Lobbies driven
+		// by an in-process caller (benchmarks) are never paused
+		std::atomic<bool> executing_;
 
 		State internalState_ = none;
 
 		Configuration* conf_;
+		// Time source of the shared memory
+		Clock* clock_;
 
 		// All clients connected to the lobby
 		int connectedClients_;
@@ -234,7 +307,18 @@ namespace hgs {
 		std::mutex setPauseMtx_;
 
 		// Dynamic allocated array holding all clients responses
-		std::vector<std::string> commandQueue_;
+		std::vector<Message> commandQueue_;
+		// Frames dropped by lobby.coalesce because a newer one arrived in the same tick
+		uint64_t coalesced_;
+
+		// Subscription channels, tagged frames only go to subscribers
+		ChannelTable channels_;
+		// Positions of the clients, frames of placed senders only reach nearby recipients
+		InterestGrid interest_;
+		// Catch-up payload for joining clients, recorded every send phase
+		SnapshotBuffer snapshot_;
+		// Authoritative key/value state, changed keys are broadcast every send phase
+		StateStore store_;
 
 		int lastCoreCall_[3];
 
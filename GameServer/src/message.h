@@ -0,0 +1,72 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Message.h
+	Purpose: A single client frame travelling through a lobby tick,
+	from the receiving client to every recipient
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// Sender id used for frames composed by the server itself
+	constexpr int serverSender = -1;
+
+	// Pipeline stages stamped on sampled messages, in the order they happen
+	enum Stage {
+		stage_recv = 0,
+		stage_decode = 1,
+		stage_enqueue = 2,
+		stage_pickup = 3,
+		stage_build = 4,
+		stage_send = 5,
+		stage_count = 6
+	};
+
+	// Sampled frames are sent with a header in front of the payload:
+	// "{id|@l=recv,decode,enqueue,pickup,build,send@payload}"
+	// where every stamp is written with stampDigits zero padded digits
+	constexpr size_t stampDigits = 15;
+
+	// Addressed frames carry their recipients in a header: "{id|@t=3,7,12@payload}",
+	// after any position and channel header
+	constexpr char targetHeader[] = "@t=";
+	constexpr size_t maxTargets = 64;
+
+	// State frames, of which only the newest per sender and channel matters, are
+	// marked after any position and channel header: "{id|@v@payload}". Every
+	// other frame is an event and is never coalesced
+	constexpr char stateHeader[] = "@v@";
+
+	// Monotonic server timestamps in microseconds, one per stage
+	struct LatencyStamps {
+		std::array<int64_t, stage_count> at = {};
+	};
+
+	struct Message {
+		// Id of the client that sent the frame
+		int sender = serverSender;
+		// The complete frame, "{id|payload}"
+		std::string frame;
+		// Only set on sampled messages
+		std::shared_ptr<LatencyStamps> stamps;
+		// Channel of the lobby the frame is tagged with, -1 goes to everyone
+		int channel = -1;
+		// Slot of the sender in its lobby, -1 for frames composed by the server
+		int slot = -1;
+		// Only goes to recipients within the interest radius of the sender
+		bool local = false;
+		// Ids of the recipients of an addressed frame, empty goes to everyone
+		std::vector<int> targets;
+		// Came in over UDP, goes out over UDP to recipients with a bound address
+		bool unreliable = false;
+		// Marked as state, a newer frame of the sender on the channel supersedes it
+		bool state = false;
+
+		// Every recipient gets the frame as is, so it can be compressed once for all of them
+		bool IsShared() const { return stamps == nullptr && channel < 0 && !local && targets.empty() && !unreliable; };
+	};
+}
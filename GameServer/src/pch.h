@@ -8,12 +8,28 @@
 #include <string>
 #include <mutex>
 #include <random>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <bitset>
+#include <map>
 
 #ifdef __linux__
 	#include <winsock2.h>
 	#include <experimental/filesystem>
 #elif _WIN32
 	#include <filesystem>
+	// Unix domain sockets, afunix.h needs the winsock2 types
+	#include <winsock2.h>
+	#include <afunix.h>
 
 // Guidelines Support Library
 #undef max
@@ -6,6 +6,7 @@ hgs::RconClient::RconClient(const SOCKET socket, const int id, const gsl::not_nu
 
 	isOnline_ = true;
 	confirmed_ = false;
+	compressing_ = false;
 
 	// Setup client logger
 	std::vector<spdlog::sink_ptr> sinks;
@@ -71,6 +72,13 @@ void hgs::RconClient::Receive() {
 		}
 	}
 
+	// Negotiated by the connection, not a console command
+	if (rconCommand == "/compress") {
+		compressing_ = core_->GetSharedMemory()->GetConfigurations().compressionEnable;
+		outgoing_ = compressing_ ? "Compression on, dictionary id " + std::to_string(core_->GetSharedMemory()->GetCompressor().GetId()) : "Compression is disabled";
+		return;
+	}
+
 	// Execute rcon command
 	const std::pair<int, std::string> result = core_->ServerCommand(rconCommand);
 	rconCommand = result.second;
@@ -83,8 +91,16 @@ void hgs::RconClient::Receive() {
 
 void hgs::RconClient::Send() const {
 	
+	const SharedMemory* memory = core_->GetSharedMemory();
+	if (compressing_ && static_cast<int>(outgoing_.size()) >= memory->GetConfigurations().compressionThreshold) {
+		std::string compressed;
+		memory->GetCompressor().Compress(outgoing_.data(), outgoing_.size(), compressed);
+		compressed.insert(compressed.begin(), compressedMarker);
+		send(socket_, compressed.c_str(), static_cast<int>(compressed.size()) + 1, 0);
+		return;
+	}
+
 	// Send response
-	// TODO encode output using compressor tool
 	send(socket_, outgoing_.c_str(), static_cast<int>(outgoing_.size()) + 1, 0);
 }
 
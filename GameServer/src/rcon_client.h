@@ -20,6 +20,8 @@ namespace hgs {
 		bool isOnline_;
 		// Has the rcon connection been approved
 		bool confirmed_;
+		// Responses above the compression threshold are compressed, asked for with /compress
+		bool compressing_;
 
 		Core* core_;
 		std::string outgoing_;
@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "reliable.h"
+
+// Definitions for C++14, std::min and std::max take the constants by reference
+constexpr size_t hgs::ReliableChannel::maxFragment;
+constexpr int64_t hgs::ReliableChannel::minRto;
+constexpr int64_t hgs::ReliableChannel::maxRto;
+
+namespace {
+	// Reads "<a>,<b>,<c>" from the start of a datagram, after the type character
+	bool ReadHeader(const std::string& datagram, uint32_t fields[3], size_t& end) {
+		const char* current = datagram.c_str() + 1;
+		for (int i = 0; i < 3; i++) {
+			char* next = nullptr;
+			const unsigned long value = std::strtoul(current, &next, 10);
+			if (next == current || value > std::numeric_limits<uint32_t>::max()) return false;
+			fields[i] = static_cast<uint32_t>(value);
+			if (i < 2) {
+				if (*next != ',') return false;
+				current = next + 1;
+			} else {
+				current = next;
+			}
+		}
+		end = static_cast<size_t>(current - datagram.c_str());
+		return true;
+	}
+}
+
+hgs::ReliableChannel::ReliableChannel() : srtt_(0), rttVariance_(0), backoff_(1), retransmits_(0) {
+}
+
+void hgs::ReliableChannel::Send(const Stream stream, const std::string& message) {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+	Outgoing& outgoing = outgoing_[stream];
+
+	size_t at = 0;
+	do {
+		const size_t length = std::min(maxFragment, message.size() - at);
+		const bool last = at + length >= message.size();
+
+		Fragment fragment;
+		fragment.sequence = outgoing.nextSequence++;
+		fragment.datagram.push_back(datagramReliable);
+		fragment.datagram.append(std::to_string(stream) + "," + std::to_string(fragment.sequence) + (last ? ",1|" : ",0|"));
+		fragment.datagram.append(message, at, length);
+		outgoing.queued.push_back(std::move(fragment));
+
+		at += length;
+	} while (at < message.size());
+}
+
+bool hgs::ReliableChannel::OnDatagram(const std::string& datagram, const int64_t now) {
+	if (datagram.size() < 6) return false;
+
+	uint32_t fields[3];
+	size_t end = 0;
+	if (!ReadHeader(datagram, fields, end) || fields[0] >= stream_count) return false;
+
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	if (datagram[0] == datagramReliable) {
+		if (end >= datagram.size() || datagram[end] != '|' || fields[2] > 1) return false;
+		OnData(incoming_[fields[0]], fields[1], fields[2] == 1, datagram.substr(end + 1));
+		return true;
+	}
+	if (datagram[0] == datagramAck) {
+		OnAck(outgoing_[fields[0]], fields[1], fields[2], now);
+		return true;
+	}
+	return false;
+}
+
+void hgs::ReliableChannel::Flush(const int64_t now, std::vector<std::string>& datagrams) {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+
+	for (size_t stream = 0; stream < stream_count; stream++) {
+		Incoming& incoming = incoming_[stream];
+		if (incoming.ackOwed) {
+			incoming.ackOwed = false;
+			const uint32_t cumulative = incoming.expected - 1;
+			uint32_t bits = 0;
+			for (auto& fragment : incoming.ahead) {
+				const uint32_t bit = fragment.first - cumulative - 2;
+				if (bit < 32) {
+					bits |= 1u << bit;
+				}
+			}
+			datagrams.push_back(std::string(1, datagramAck) + std::to_string(stream) + "," + std::to_string(cumulative) + "," + std::to_string(bits));
+		}
+
+		Outgoing& outgoing = outgoing_[stream];
+		while (!outgoing.queued.empty() && outgoing.inFlight.size() < window) {
+			outgoing.inFlight.push_back(std::move(outgoing.queued.front()));
+			outgoing.queued.pop_front();
+		}
+
+		const int64_t rto = std::min(GetRto() * backoff_, maxRto);
+		bool timedOut = false;
+		for (auto& fragment : outgoing.inFlight) {
+			if (fragment.acked) continue;
+			if (!fragment.sent) {
+				fragment.sent = true;
+			}
+			else if (now - fragment.sentAt >= rto) {
+				fragment.retransmitted = true;
+				timedOut = true;
+				retransmits_++;
+			}
+			else {
+				continue;
+			}
+			fragment.sentAt = now;
+			datagrams.push_back(fragment.datagram);
+		}
+		if (timedOut && backoff_ < 64) {
+			backoff_ *= 2;
+		}
+	}
+}
+
+bool hgs::ReliableChannel::Receive(std::string& message) {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+	for (auto& incoming : incoming_) {
+		if (!incoming.complete.empty()) {
+			message = std::move(incoming.complete.front());
+			incoming.complete.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool hgs::ReliableChannel::HasMessages() const {
+	std::lock_guard<std::mutex> lock(channelMtx_);
+	for (auto& incoming : incoming_) {
+		if (!incoming.complete.empty()) return true;
+	}
+	return false;
+}
+
+int64_t hgs::ReliableChannel::GetRto() const {
+	if (srtt_ == 0) return initialRto;
+	// The variance term never drops below minRto, bursts acked together leave it close to 0
+	return std::min(srtt_ + std::max(4 * rttVariance_, minRto), maxRto);
+}
+
+void hgs::ReliableChannel::OnData(Incoming& incoming, const uint32_t sequence, const bool last, std::string data) {
+	// Duplicates are acked again, their first ack may have been lost
+	incoming.ackOwed = true;
+	if (!After(sequence, incoming.expected - 1)) return;
+	if (sequence - incoming.expected >= window) return;
+
+	incoming.ahead.emplace(sequence, std::make_pair(last, std::move(data)));
+
+	// Deliver everything that is now in order
+	auto next = incoming.ahead.find(incoming.expected);
+	while (next != incoming.ahead.end()) {
+		if (!incoming.oversized) {
+			incoming.partial.append(next->second.second);
+			if (incoming.partial.size() > maxMessage) {
+				incoming.oversized = true;
+				incoming.partial.clear();
+			}
+		}
+		if (next->second.first) {
+			if (!incoming.oversized) {
+				incoming.complete.push_back(std::move(incoming.partial));
+			}
+			incoming.partial.clear();
+			incoming.oversized = false;
+		}
+		incoming.ahead.erase(next);
+		incoming.expected++;
+		next = incoming.ahead.find(incoming.expected);
+	}
+}
+
+void hgs::ReliableChannel::OnAck(Outgoing& outgoing, const uint32_t cumulative, const uint32_t bits, const int64_t now) {
+	// One round trip sample per ack, from the newest fragment it covers
+	int64_t sample = -1;
+	for (auto& fragment : outgoing.inFlight) {
+		if (fragment.acked || !fragment.sent) continue;
+
+		const uint32_t bit = fragment.sequence - cumulative - 2;
+		if (After(fragment.sequence, cumulative) && (bit >= 32 || (bits & (1u << bit)) == 0)) continue;
+
+		fragment.acked = true;
+		// Karn, a resent fragment can't tell which copy was acked
+		if (!fragment.retransmitted) {
+			sample = now - fragment.sentAt;
+		}
+	}
+	if (sample >= 0) {
+		SampleRtt(sample);
+	}
+
+	while (!outgoing.inFlight.empty() && outgoing.inFlight.front().acked) {
+		outgoing.inFlight.pop_front();
+	}
+}
+
+void hgs::ReliableChannel::SampleRtt(const int64_t rtt) {
+	// Smoothing as in RFC 6298
+	if (srtt_ == 0) {
+		srtt_ = std::max<int64_t>(rtt, 1);
+		rttVariance_ = rtt / 2;
+	} else {
+		rttVariance_ = (3 * rttVariance_ + std::abs(srtt_ - rtt)) / 4;
+		srtt_ = std::max<int64_t>((7 * srtt_ + rtt) / 8, 1);
+	}
+	backoff_ = 1;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Reliable.h
+	Purpose: Reliable, ordered message streams on top of the UDP path.
+	Every stream is sequenced on its own so a lost datagram only holds
+	back its own stream, losses are found through selective acks and
+	resent on a timer driven by the measured round trip
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	/**
+		Datagrams of a channel:
+		"R<stream>,<sequence>,<last>|<data>" one fragment, <last> is 1 on the final fragment of a message
+		"A<stream>,<cumulative>,<bits>" every sequence up to <cumulative> arrived, bit i
+		of <bits> tells that sequence <cumulative> + 2 + i arrived as well
+	 */
+	constexpr char datagramReliable = 'R';
+	constexpr char datagramAck = 'A';
+
+	enum Stream {
+		// API calls, their replies and core calls
+		stream_control = 0,
+		// Game frames a client wants delivered, a large fragmented
+		// frame never holds back the control stream
+		stream_frames = 1,
+		stream_count = 2
+	};
+
+	/**
+		One end of a connection. Safe to use from several
+		threads, the client thread pumps it and the lobby
+		may queue messages while detaching the client
+	 */
+	class ReliableChannel {
+	public:
+		// Fragments in flight per stream, the ack bitfield covers them all
+		static constexpr uint32_t window = 32;
+		// Data per fragment, leaves room for the header under common MTUs
+		static constexpr size_t maxFragment = 1100;
+		// Larger messages are dropped on arrival
+		static constexpr size_t maxMessage = 65536;
+		static constexpr int64_t initialRto = 200000;
+		static constexpr int64_t minRto = 10000;
+		static constexpr int64_t maxRto = 2000000;
+
+		ReliableChannel();
+		/**
+			Queue a message, split into fragments
+			when it is larger than maxFragment
+
+			@param stream Stream to send on
+			@param message Any bytes
+			@return void
+		 */
+		void Send(Stream stream, const std::string& message);
+		/**
+			Handle a data or ack datagram from the remote end
+
+			@param datagram Complete datagram
+			@param now Arrival time in microseconds
+			@return bool False if the datagram is malformed
+		 */
+		bool OnDatagram(const std::string& datagram, int64_t now);
+		/**
+			Collect the datagrams due: acks owed, fragments
+			that fit the window and fragments whose
+			retransmit timer ran out
+
+			@param now Microseconds
+			@param datagrams Appended to
+			@return void
+		 */
+		void Flush(int64_t now, std::vector<std::string>& datagrams);
+		/**
+			Take the next complete message, lower
+			streams are drained first
+
+			@param message Receives the message
+			@return bool False if no message is complete
+		 */
+		bool Receive(std::string& message);
+
+		bool HasMessages() const;
+		// Retransmit timeout in microseconds, from the smoothed round trip
+		int64_t GetRto() const;
+		uint64_t GetRetransmits() const { return retransmits_; };
+	private:
+		struct Fragment {
+			uint32_t sequence = 0;
+			std::string datagram;
+			int64_t sentAt = 0;
+			bool sent = false;
+			bool retransmitted = false;
+			bool acked = false;
+		};
+
+		struct Outgoing {
+			uint32_t nextSequence = 1;
+			// Fragments waiting for the window
+			std::deque<Fragment> queued;
+			std::deque<Fragment> inFlight;
+		};
+
+		struct Incoming {
+			// Next sequence to deliver
+			uint32_t expected = 1;
+			// Fragments that arrived ahead of expected, with their last flag
+			std::map<uint32_t, std::pair<bool, std::string>> ahead;
+			std::string partial;
+			// The message being assembled outgrew maxMessage
+			bool oversized = false;
+			std::deque<std::string> complete;
+			bool ackOwed = false;
+		};
+
+		void OnData(Incoming& incoming, uint32_t sequence, bool last, std::string data);
+		void OnAck(Outgoing& outgoing, uint32_t cumulative, uint32_t bits, int64_t now);
+		void SampleRtt(int64_t rtt);
+		// Sequence a is later than b, across wrap around
+		static bool After(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) > 0; };
+
+		std::array<Outgoing, stream_count> outgoing_;
+		std::array<Incoming, stream_count> incoming_;
+
+		int64_t srtt_;
+		int64_t rttVariance_;
+		// Doubles on every timeout, reset by the next round trip sample
+		int backoff_;
+		uint64_t retransmits_;
+
+		mutable std::mutex channelMtx_;
+	};
+
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <utility>
+
+/**
+	Schema.h
+	Purpose: Typed game messages. A schema is a list of field types and
+	the compiler generates its encoder, decoder and field offsets, so
+	fixed width fields can be read straight out of a frame without
+	decoding the rest. Only needs the standard library, client code
+	includes it as is
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+	namespace schema {
+
+		// Typed payloads start with a header naming their schema: "@s=<id>@<fields>"
+		constexpr char schemaHeader[] = "@s=";
+		// Width and offset of anything that follows a variable length field
+		constexpr size_t variable = static_cast<size_t>(-1);
+
+		// Fields are written with 64 digits that are none of the protocol delimiters,
+		// 6 bits per digit and the most significant digit first
+		constexpr char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+		constexpr int DigitValue(const char digit) {
+			return digit >= 'A' && digit <= 'Z' ? digit - 'A' :
+				digit >= 'a' && digit <= 'z' ? digit - 'a' + 26 :
+				digit >= '0' && digit <= '9' ? digit - '0' + 52 :
+				digit == '-' ? 62 : digit == '_' ? 63 : -1;
+		}
+
+		/**
+			Read the schema header at an offset of a frame
+
+			@param frame Payload
+			@param at Offset of the header
+			@param id Set to the schema id
+			@return size_t Offset of the first field, 0 if there is no valid header
+		 */
+		inline size_t ReadHeader(const std::string& frame, const size_t at, uint32_t& id) {
+			if (frame.compare(at, 3, schemaHeader) != 0) return 0;
+
+			uint64_t value = 0;
+			size_t i = at + 3;
+			for (; i < frame.size() && frame[i] >= '0' && frame[i] <= '9' && i < at + 13; i++) {
+				value = value * 10 + static_cast<uint64_t>(frame[i] - '0');
+			}
+			if (i == at + 3 || i >= frame.size() || frame[i] != '@' || value > UINT32_MAX) return 0;
+
+			id = static_cast<uint32_t>(value);
+			return i + 1;
+		}
+
+		// Unsigned integer in a fixed number of digits, only the low bits are kept
+		template <int Bits>
+		struct Unsigned {
+			static_assert(Bits > 0 && Bits <= 64, "Unsigned fields hold 1 to 64 bits");
+			using Type = uint64_t;
+
+			static constexpr size_t Width() { return (Bits + 5) / 6; }
+			static constexpr uint64_t Max() { return Bits == 64 ? UINT64_MAX : (uint64_t(1) << Bits) - 1; }
+
+			static void Write(std::string& out, const Type value) {
+				const uint64_t kept = value & Max();
+				for (size_t i = Width(); i > 0; i--) {
+					out.push_back(digits[(kept >> ((i - 1) * 6)) & 63]);
+				}
+			}
+			static bool Read(const char*& at, const char* end, Type& value) {
+				if (static_cast<size_t>(end - at) < Width()) return false;
+
+				uint64_t result = 0;
+				for (size_t i = 0; i < Width(); i++) {
+					const int digit = DigitValue(at[i]);
+					if (digit < 0) return false;
+					result = result << 6 | static_cast<uint64_t>(digit);
+				}
+				if (result > Max()) return false;
+
+				value = result;
+				at += Width();
+				return true;
+			}
+		};
+
+		// Unsigned integer in as few digits as it needs, 5 bits per digit
+		// and the sixth marks that more digits follow, least significant first
+		struct Varint {
+			using Type = uint64_t;
+
+			static constexpr size_t Width() { return variable; }
+
+			static void Write(std::string& out, Type value) {
+				while (value >= 32) {
+					out.push_back(digits[(value & 31) | 32]);
+					value >>= 5;
+				}
+				out.push_back(digits[value]);
+			}
+			static bool Read(const char*& at, const char* end, Type& value) {
+				uint64_t result = 0;
+				for (int shift = 0; at < end && shift < 65; shift += 5) {
+					const int digit = DigitValue(*at);
+					if (digit < 0) return false;
+					const uint64_t bits = static_cast<uint64_t>(digit & 31);
+					// The 13th digit only has room for the 4 top bits
+					if (shift == 60 && bits > 15) return false;
+					result |= bits << shift;
+					at++;
+					if ((digit & 32) == 0) {
+						value = result;
+						return true;
+					}
+				}
+				return false;
+			}
+		};
+
+		// Signed integer as a varint, zigzag mapped so small negative numbers stay short
+		struct SignedVarint {
+			using Type = int64_t;
+
+			static constexpr size_t Width() { return variable; }
+
+			static void Write(std::string& out, const Type value) {
+				Varint::Write(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+			}
+			static bool Read(const char*& at, const char* end, Type& value) {
+				uint64_t zigzag = 0;
+				if (!Varint::Read(at, end, zigzag)) return false;
+				value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+				return true;
+			}
+		};
+
+		// Float clamped to [Min, Max] and rounded onto 2^Bits - 1 even steps
+		template <int Min, int Max, int Bits>
+		struct Quantized {
+			static_assert(Min < Max, "Quantized fields need Min below Max");
+			static_assert(Bits > 0 && Bits <= 32, "Quantized fields hold 1 to 32 bits");
+			using Type = float;
+
+			static constexpr size_t Width() { return Unsigned<Bits>::Width(); }
+			static constexpr double Step() { return (static_cast<double>(Max) - Min) / Unsigned<Bits>::Max(); }
+
+			static void Write(std::string& out, const Type value) {
+				// NaN ends up at Min
+				const double clamped = !(value > Min) ? Min : value < Max ? static_cast<double>(value) : Max;
+				Unsigned<Bits>::Write(out, static_cast<uint64_t>(std::llround((clamped - Min) / Step())));
+			}
+			static bool Read(const char*& at, const char* end, Type& value) {
+				uint64_t steps = 0;
+				if (!Unsigned<Bits>::Read(at, end, steps)) return false;
+				value = static_cast<float>(Min + static_cast<double>(steps) * Step());
+				return true;
+			}
+		};
+
+		/**
+			A typed message, fields are written back to back
+			in the order they are listed. Offsets are known at
+			compile time up to the first variable length field
+		 */
+		template <uint32_t Id, typename... Fields>
+		class Schema {
+		public:
+			using Tuple = std::tuple<typename Fields::Type...>;
+			template <size_t I>
+			using Field = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+			static constexpr uint32_t GetId() { return Id; }
+			// Characters in front of field I, variable if a varint comes before it
+			template <size_t I>
+			static constexpr size_t Offset() {
+				static_assert(I <= sizeof...(Fields), "Schema has no such field");
+				const size_t widths[] = { Fields::Width()..., 0 };
+				size_t offset = 0;
+				for (size_t i = 0; i < I; i++) {
+					if (widths[i] == variable) return variable;
+					offset += widths[i];
+				}
+				return offset;
+			}
+			// Characters of every field, variable if any of them is
+			static constexpr size_t Width() { return Offset<sizeof...(Fields)>(); }
+
+			/**
+				Append the header and every field
+
+				@param out Payload under construction
+				@param values One value per field
+				@return void
+			 */
+			static void Encode(std::string& out, const Tuple& values) {
+				out.append(schemaHeader);
+				out.append(std::to_string(Id));
+				out.push_back('@');
+				Write(out, values, std::index_sequence_for<Fields...>());
+			}
+			/**
+				Read every field, the header is expected to be read
+				already with ReadHeader and to name this schema
+
+				@param frame Payload
+				@param at Offset of the first field
+				@param values Filled in field by field
+				@return size_t Offset after the last field, 0 if a field is malformed
+			 */
+			static size_t Decode(const std::string& frame, const size_t at, Tuple& values) {
+				const char* current = frame.data() + at;
+				if (!Read(current, frame.data() + frame.size(), values, std::index_sequence_for<Fields...>())) return 0;
+				return static_cast<size_t>(current - frame.data());
+			}
+			/**
+				Read one field at its compile time offset
+				without touching the fields before it
+
+				@param frame Payload
+				@param at Offset of the first field
+				@param value Set to the field
+				@return bool False if the field is malformed
+			 */
+			template <size_t I>
+			static bool Get(const std::string& frame, const size_t at, typename Field<I>::Type& value) {
+				static_assert(Offset<I>() != variable, "Field follows a variable length field");
+				if (at + Offset<I>() > frame.size()) return false;
+				const char* current = frame.data() + at + Offset<I>();
+				return Field<I>::Read(current, frame.data() + frame.size(), value);
+			}
+		private:
+			template <size_t... I>
+			static void Write(std::string& out, const Tuple& values, std::index_sequence<I...>) {
+				// Braced lists are evaluated left to right, fields land in order
+				const int expand[] = { 0, (Field<I>::Write(out, std::get<I>(values)), 0)... };
+				(void)expand;
+			}
+			template <size_t... I>
+			static bool Read(const char*& at, const char* end, Tuple& values, std::index_sequence<I...>) {
+				bool valid = true;
+				const int expand[] = { 0, (valid = valid && Field<I>::Read(at, end, std::get<I>(values)), 0)... };
+				(void)expand;
+				return valid;
+			}
+		};
+
+	}
+
+	// Schemas the server reads itself
+
+	// Typed form of the position header, both coordinates quantized to 1/256
+	// of a world unit in a fixed 8 digits: "{id|@s=1@xxxxyyyy payload}"
+	using PositionSchema = schema::Schema<1, schema::Quantized<-32768, 32768, 24>, schema::Quantized<-32768, 32768, 24>>;
+}
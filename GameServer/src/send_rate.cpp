@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "send_rate.h"
+
+hgs::SendRateControl::SendRateControl() : maxInterval_(1), tick_(0), rttLimit_(0), interval_(1), elapsed_(0), cleanSends_(0), cooldown_(0), throughput_(0) {
+}
+
+void hgs::SendRateControl::Configure(const int max_interval, const int64_t tick, const int64_t rtt_limit) {
+	maxInterval_ = std::max(max_interval, 1);
+	tick_ = tick;
+	rttLimit_ = rtt_limit;
+	interval_ = 1;
+	elapsed_ = 0;
+}
+
+bool hgs::SendRateControl::Tick() {
+	elapsed_++;
+	if (elapsed_ < interval_) return false;
+	elapsed_ = 0;
+	return true;
+}
+
+void hgs::SendRateControl::OnSent(const size_t bytes, const int64_t duration, const LinkStats& link) {
+	if (!IsEnabled()) return;
+
+	// Sends that return at once only say the socket buffer had room
+	if (duration > 0) {
+		const int64_t rate = static_cast<int64_t>(bytes) * 1000000 / duration;
+		throughput_ = (throughput_ == 0 ? rate : (throughput_ * 7 + rate) / 8);
+	}
+
+	// A send blocking for half a tick means the socket buffer is full
+	const bool congested = duration > tick_ / 2 || (rttLimit_ > 0 && link.HasSamples() && link.rtt > rttLimit_);
+	if (cooldown_ > 0) {
+		cooldown_--;
+	}
+
+	if (congested) {
+		cleanSends_ = 0;
+		if (cooldown_ == 0 && interval_ < maxInterval_) {
+			interval_ = std::min(interval_ * 2, maxInterval_);
+			cooldown_ = 4;
+		}
+		return;
+	}
+
+	if (++cleanSends_ >= recoverSends && interval_ > 1) {
+		interval_--;
+		cleanSends_ = 0;
+	}
+}
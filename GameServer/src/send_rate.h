@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+#include "link_quality.h"
+
+/**
+	SendRate.h
+	Purpose: Adaptive send rate of one client. Clients on constrained
+	links are sent every k:th tick instead of every tick, k grows when
+	sends block or the round trip climbs and shrinks again once the
+	link keeps up
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	/**
+		The interval doubles on congestion and steps back
+		by one after a run of clean sends, so a slow link
+		backs off quickly and recovers carefully
+	 */
+	class SendRateControl {
+	public:
+		// Clean sends in a row before the interval shrinks
+		static constexpr int recoverSends = 8;
+
+		SendRateControl();
+		/**
+			@param max_interval Longest interval in ticks, 1 or less disables
+			@param tick Microseconds between ticks of the lobby
+			@param rtt_limit Round trip in microseconds above which the link counts as congested
+			@return void
+		 */
+		void Configure(int max_interval, int64_t tick, int64_t rtt_limit);
+		/**
+			Advance one tick
+
+			@return bool True if the client is sent this tick
+		 */
+		bool Tick();
+		/**
+			Adjust the interval after a payload went out
+
+			@param bytes Payload size
+			@param duration Microseconds the send call blocked
+			@param link Current round trip estimate
+			@return void
+		 */
+		void OnSent(size_t bytes, int64_t duration, const LinkStats& link);
+
+		bool IsEnabled() const { return maxInterval_ > 1; };
+		int GetInterval() const { return interval_; };
+		// Smoothed bytes per second the link took, 0 until a send blocked measurably
+		int64_t GetThroughput() const { return throughput_; };
+	private:
+		int maxInterval_;
+		int64_t tick_;
+		int64_t rttLimit_;
+
+		std::atomic<int> interval_;
+		// Ticks since the last send
+		int elapsed_;
+		int cleanSends_;
+		// Sends to wait before reacting to congestion again, the round trip lags behind
+		int cooldown_;
+		std::atomic<int64_t> throughput_;
+	};
+
+}
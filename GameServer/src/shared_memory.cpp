@@ -8,6 +8,28 @@ hgs::SharedMemory::SharedMemory(const Configuration& conf) : conf_(conf) {
 	SetupLogging();
 
 	coreCall_.clear();
+
+	if (conf_.compressionEnable && !conf_.compressionDictionary.empty()) {
+		std::ifstream file(conf_.compressionDictionary, std::ios::in | std::ios::binary);
+		if (file.is_open()) {
+			const std::string dictionary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			compressor_ = Compressor(dictionary);
+			log_->info("Loaded compression dictionary " + conf_.compressionDictionary + ", " + std::to_string(compressor_.GetDictionary().size()) +
+				" bytes, id " + std::to_string(compressor_.GetId()));
+		} else {
+			log_->warn("Could not open compression dictionary " + conf_.compressionDictionary + ", compressing without one");
+		}
+	}
+
+	admission_.Configure(conf_.admissionMaxPerAddress, conf_.admissionPerMinute, conf_.admissionBurst);
+	if (!conf_.admissionBlocklist.empty()) {
+		const int prefixes = admission_.LoadBlocklist(conf_.admissionBlocklist);
+		if (prefixes >= 0) {
+			log_->info("Loaded " + std::to_string(prefixes) + " blocked prefixes from " + conf_.admissionBlocklist);
+		} else {
+			log_->warn("Could not open blocklist " + conf_.admissionBlocklist + ", starting with an empty one");
+		}
+	}
 }
 
 hgs::SharedMemory::~SharedMemory() {
@@ -71,8 +93,7 @@ void hgs::SharedMemory::DropSocket(const SOCKET socket) {
 		if (dropSocketMtx_.try_lock()) {
 			// Decrease online clients
 			connectedClients_--;
-			// Clear the socket
-			closesocket(socket);
+			admission_.Release(socket);
 			// Remove socket from socketList
 			FD_CLR(socket, &sockets_);
 			dropSocketMtx_.unlock();
@@ -116,6 +137,25 @@ std::pair<hgs::Client*, hgs::Lobby*> hgs::SharedMemory::FindClient(const int cli
 	return std::make_pair(nullptr, nullptr);
 }
 
+void hgs::SharedMemory::AddSuspended(gsl::not_null<Client*> client) {
+	std::lock_guard<std::mutex> lock(suspendedMtx_);
+	suspended_[client->id] = client;
+}
+
+void hgs::SharedMemory::DropSuspended(const int client_id) {
+	std::lock_guard<std::mutex> lock(suspendedMtx_);
+	suspended_.erase(client_id);
+}
+
+bool hgs::SharedMemory::ResumeClient(const int client_id, const std::string& token, std::unique_ptr<Transport>& transport) {
+	std::lock_guard<std::mutex> lock(suspendedMtx_);
+	auto found = suspended_.find(client_id);
+	if (found == suspended_.end()) {
+		return false;
+	}
+	return found->second->Resume(token, transport);
+}
+
 hgs::Lobby* hgs::SharedMemory::FindLobby(const int lobby_id) const {
 	Lobby* current = firstLobby_;
 
@@ -140,7 +180,7 @@ hgs::Lobby* hgs::SharedMemory::FindLobby(std::string& name_tag) const {
 	return nullptr;
 }
 
-hgs::Lobby* hgs::SharedMemory::AddLobby(std::string name) {
+hgs::Lobby* hgs::SharedMemory::AddLobby(std::string name, const bool threaded) {
 	while (true) {
 		if (addLobbyMtx_.try_lock()) {
 			if (conf_.lobbyMaxConnections <= lobbiesAlive_ && conf_.lobbyMaxConnections != 0) {
@@ -169,8 +209,9 @@ hgs::Lobby* hgs::SharedMemory::AddLobby(std::string name) {
 
 			// Release lobby to another thread
 			// Connect the new client to a new thread
-			std::thread lobbyThread(&Lobby::Execute, newLobby);
-			lobbyThread.detach();
+			if (threaded) {
+				newLobby->Start();
+			}
 
 			addLobbyMtx_.unlock();
 			return newLobby;
@@ -197,9 +238,7 @@ hgs::Lobby* hgs::SharedMemory::CreateMainLobby() {
 			lastLobby_ = newLobby;
 
 			// Release lobby to another thread
-			// Connect the new client to a new thread
-			std::thread lobbyThread(&Lobby::Execute, newLobby);
-			lobbyThread.detach();
+			newLobby->Start();
 
 			addLobbyMtx_.unlock();
 			return newLobby;
@@ -286,4 +325,6 @@ int hgs::SharedMemory::GetLobbyId(std::string& string) const {
 	return -1;
 }
 
-void hgs::SharedMemory::SetSockets(const fd_set list) { sockets_ = list; }
\ No newline at end of file
+void hgs::SharedMemory::SetSockets(const fd_set list) { sockets_ = list; }
+
+void hgs::SharedMemory::SetClock(const gsl::not_null<Clock*> clock) { clock_ = clock; }
\ No newline at end of file
@@ -1,6 +1,12 @@
 #pragma once
 #include "lobby.h"
 #include "utilities.h"
+#include "latency.h"
+#include "clock.h"
+#include "compressor.h"
+#include "udp.h"
+#include "admission.h"
+#include "transport.h"
 
 /**
     SharedMemory.h
@@ -39,7 +45,10 @@ namespace hgs {
 		/**
 			Drop as specific socket from
 			the shared memory and decrease
-			the connected client count
+			the connected client count. Closing
+			is left to the client's transport,
+			the socket has to be dropped before
+			it is closed since handles are reused
 
 			@param socket Socket for to drop
 			@return void
@@ -71,6 +80,33 @@ namespace hgs {
 			@return Lobby* if client is found, otherwise nullptr
 		 */
 		Lobby* FindLobby(int lobby_id) const;
+		/**
+			Make a suspended client reachable
+			for #resume from other client threads
+
+			@param client The client that lost its connection
+			@return void
+		 */
+		void AddSuspended(gsl::not_null<Client*> client);
+		/**
+			Remove a client from the suspended clients,
+			blocks while a resume is handing it a connection
+
+			@param client_id Id of the client
+			@return void
+		 */
+		void DropSuspended(int client_id);
+		/**
+			Find a suspended client and hand it a connection,
+			both under one lock so the client can't be
+			destroyed in between
+
+			@param client_id Id of the suspended client
+			@param token Resume token from the welcome message
+			@param transport Connection to hand over, moved out on success
+			@return bool True if the client took the connection
+		 */
+		bool ResumeClient(int client_id, const std::string& token, std::unique_ptr<Transport>& transport);
 		/**
 			Iterate through the memory to find the specified lobby
 
@@ -85,9 +121,11 @@ namespace hgs {
 			all other activities
 
 			@param name The name of the lobby
+			@param threaded Run the lobby loop on its own thread, in-process
+			drivers such as benchmarks call the loop themselves
 			@return Lobby*
 		*/
-		Lobby* AddLobby(std::string name = "");
+		Lobby* AddLobby(std::string name = "", bool threaded = true);
 		/**
 			Create a main lobby which all
 			user will be connected to
@@ -137,10 +175,24 @@ namespace hgs {
 		 */
 		int GetLobbyId(std::string& string) const;
 		int GetLobbyCount() const { return lobbiesAlive_; };
+		LatencyHistogram& GetLatency() { return latency_; };
+		Clock& GetClock() const { return *clock_; };
+		const Compressor& GetCompressor() const { return compressor_; };
+		UdpGateway& GetUdp() { return udp_; };
+		Admission& GetAdmission() { return admission_; };
 
 		// Setters
 
 		void SetSockets(fd_set list);
+		/**
+			Replace the system clock, lobbies and clients
+			read the clock when they are created so it
+			has to be set before the first lobby
+
+			@param clock Clock outliving the shared memory
+			@return void
+		 */
+		void SetClock(gsl::not_null<Clock*> clock);
 
 	private:
 		// A collection of all sockets
@@ -157,6 +209,10 @@ namespace hgs {
 		std::mutex dropSocketMtx_;
 		std::mutex addLobbyMtx_;
 		std::mutex dropLobbyMtx_;
+		std::mutex suspendedMtx_;
+
+		// Clients holding their session for #resume, by id
+		std::unordered_map<int, Client*> suspended_;
 
 		// Index adding up for each connected client
 		int lobbyIndex_ = 0;
@@ -176,6 +232,21 @@ namespace hgs {
 		std::vector<std::vector<int>> coreCall_;
 
 		std::shared_ptr<spdlog::sinks::rotating_file_sink<std::mutex>> sharedFileSink_;
+
+		// Per-stage latency of sampled messages
+		LatencyHistogram latency_;
+
+		SystemClock systemClock_;
+		Clock* clock_ = &systemClock_;
+
+		// Shared by every lobby, the dictionary is fixed for the server's lifetime
+		Compressor compressor_;
+
+		// Datagram path for state frames, closed unless udp.enable is set
+		UdpGateway udp_;
+
+		// Blocklist and per address limits checked right after accept
+		Admission admission_;
 	};
 
 }
\ No newline at end of file
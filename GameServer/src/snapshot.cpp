@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "snapshot.h"
+
+hgs::SnapshotBuffer::SnapshotBuffer(const size_t ticks) : ticks_(ticks), tick_(0) {
+}
+
+void hgs::SnapshotBuffer::Record(const std::vector<Message>& queue) {
+	std::lock_guard<std::mutex> lock(snapshotMtx_);
+
+	tick_++;
+	Tick* recorded = (ticks_.empty() ? nullptr : &ticks_[tick_ % ticks_.size()]);
+	if (recorded != nullptr) {
+		recorded->frames.clear();
+		recorded->count = 0;
+	}
+
+	for (auto& message : queue) {
+		// A joiner only catches up on what it would have received at any distance
+		if (message.sender == serverSender || message.channel >= 0 || message.local || !message.targets.empty()) continue;
+
+		if (recorded != nullptr) {
+			recorded->frames.append(message.frame);
+			recorded->count++;
+		}
+
+		// A client that left, "{id|D}", has no state to catch up on
+		const std::string& frame = message.frame;
+		if (frame.size() >= 4 && frame.find('|') == frame.size() - 3 && frame.compare(frame.size() - 2, 2, "D}") == 0) {
+			latest_.erase(message.sender);
+			continue;
+		}
+		Latest& latest = latest_[message.sender];
+		latest.tick = tick_;
+		latest.frame = message.frame;
+	}
+}
+
+void hgs::SnapshotBuffer::Forget(const int sender) {
+	std::lock_guard<std::mutex> lock(snapshotMtx_);
+	latest_.erase(sender);
+}
+
+std::string hgs::SnapshotBuffer::Compose() const {
+	std::lock_guard<std::mutex> lock(snapshotMtx_);
+
+	// Kept ticks still hold the latest frame of senders heard from in them
+	const uint64_t kept = std::min<uint64_t>(ticks_.size(), tick_);
+	const uint64_t oldest = tick_ - kept + 1;
+
+	std::string frames;
+	size_t count = 0;
+	for (auto& latest : latest_) {
+		if (latest.second.tick < oldest) {
+			frames.append(latest.second.frame);
+			count++;
+		}
+	}
+	for (uint64_t tick = oldest; tick <= tick_ && kept > 0; tick++) {
+		const Tick& recorded = ticks_[tick % ticks_.size()];
+		frames.append(recorded.frames);
+		count += recorded.count;
+	}
+
+	if (count == 0) {
+		return "";
+	}
+	return "{0|" + std::string(1, snapshotCommand) + std::to_string(count) + "}" + frames;
+}
+
+void hgs::SnapshotBuffer::Clear() {
+	std::lock_guard<std::mutex> lock(snapshotMtx_);
+
+	for (auto& recorded : ticks_) {
+		recorded.frames.clear();
+		recorded.count = 0;
+	}
+	latest_.clear();
+	tick_ = 0;
+}
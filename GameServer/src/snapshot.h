@@ -0,0 +1,82 @@
+#pragma once
+#include "pch.h"
+#include "message.h"
+
+/**
+	Snapshot.h
+	Purpose: Catch-up memory of a lobby. Keeps the latest frame of every
+	sender and every frame of the last ticks, so a joining client gets
+	the state of the lobby in one payload instead of asking its peers
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// A snapshot starts with "{0|C<frames>}", the next <frames>
+	// frames of the payload were sent before the client joined
+	constexpr char snapshotCommand = 'C';
+
+	/**
+		The lobby thread records once per tick and joins compose
+		once the lobby is paused. The lock still covers clients
+		moving out of the lobby, a move doesn't pause it
+	 */
+	class SnapshotBuffer {
+	public:
+		/**
+			@param ticks Ticks kept in full, 0 only keeps
+			the latest frame of every sender
+		 */
+		explicit SnapshotBuffer(size_t ticks);
+		/**
+			Remember the frames of a tick every client can see,
+			channel, addressed and interest filtered frames
+			are left out
+
+			@param queue Frames of the tick
+			@return void
+		 */
+		void Record(const std::vector<Message>& queue);
+		/**
+			Forget the latest frame of a sender
+			that left the lobby
+
+			@param sender Client id
+			@return void
+		 */
+		void Forget(int sender);
+		/**
+			Compose the catch-up payload, the latest frame of
+			every sender not heard from in the kept ticks followed
+			by the kept ticks, oldest first
+
+			@return std::string Empty if nothing was recorded
+		 */
+		std::string Compose() const;
+		/**
+			Drop everything recorded
+
+			@return void
+		 */
+		void Clear();
+	private:
+		struct Latest {
+			uint64_t tick;
+			std::string frame;
+		};
+		struct Tick {
+			std::string frames;
+			size_t count = 0;
+		};
+
+		// Ring of the last ticks, tick n lives at n % size
+		std::vector<Tick> ticks_;
+		uint64_t tick_;
+		std::unordered_map<int, Latest> latest_;
+
+		mutable std::mutex snapshotMtx_;
+	};
+
+}
@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "store.h"
+
+namespace {
+	bool IsKey(const std::string& key) {
+		if (key.empty() || key.size() > hgs::StateStore::maxKeyLength) return false;
+		for (char character : key) {
+			if (!std::isalnum(static_cast<unsigned char>(character)) && character != '_' && character != '-' && character != '.') {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReadInt(const std::string& string, int64_t& value) {
+		try {
+			size_t used = 0;
+			value = std::stoll(string, &used);
+			return used == string.size();
+		}
+		catch (...) { return false; }
+	}
+}
+
+bool hgs::StoreMutation::Parse(const std::vector<std::string>& segment, StoreMutation& mutation) {
+	if (segment.size() < 2 || !IsKey(segment[1])) return false;
+	mutation.key = segment[1];
+
+	if (segment[0] == "#set" && segment.size() >= 3) {
+		mutation.operation = set;
+		mutation.value = segment[2];
+	}
+	else if (segment[0] == "#inc") {
+		mutation.operation = increment;
+		mutation.amount = 1;
+		if (segment.size() >= 3 && !ReadInt(segment[2], mutation.amount)) return false;
+	}
+	else if (segment[0] == "#cas" && segment.size() >= 4) {
+		int64_t version;
+		if (!ReadInt(segment[2], version) || version < 0) return false;
+		mutation.operation = compare_and_swap;
+		mutation.version = static_cast<uint64_t>(version);
+		mutation.value = segment[3];
+	}
+	else {
+		return false;
+	}
+	return mutation.value.size() <= StateStore::maxValueLength;
+}
+
+hgs::StateStore::StateStore(const size_t max_keys) : maxKeys_(max_keys), mask_(0), size_(0) {
+	if (maxKeys_ == 0) return;
+
+	size_t capacity = 1;
+	while (capacity < maxKeys_ * 2) {
+		capacity <<= 1;
+	}
+	entries_.resize(capacity);
+	mask_ = capacity - 1;
+}
+
+std::string hgs::StateStore::Apply(const StoreMutation& mutation) {
+	std::lock_guard<std::mutex> lock(storeMtx_);
+
+	Entry* entry = Find(mutation.key, mutation.operation != StoreMutation::compare_and_swap || mutation.version == 0);
+	if (entry == nullptr) {
+		if (mutation.operation == StoreMutation::compare_and_swap && mutation.version != 0) {
+			return "Version mismatch " + mutation.key + ":0";
+		}
+		return "Store is full";
+	}
+
+	switch (mutation.operation) {
+	case StoreMutation::set:
+		entry->value = mutation.value;
+		break;
+	case StoreMutation::increment: {
+		int64_t current = 0;
+		if (!entry->value.empty() && !ReadInt(entry->value, current)) {
+			return "Not a number " + mutation.key;
+		}
+		if ((mutation.amount > 0 && current > std::numeric_limits<int64_t>::max() - mutation.amount) ||
+			(mutation.amount < 0 && current < std::numeric_limits<int64_t>::min() - mutation.amount)) {
+			return "Overflow " + mutation.key;
+		}
+		entry->value = std::to_string(current + mutation.amount);
+		break;
+	}
+	case StoreMutation::compare_and_swap:
+		if (entry->version != mutation.version) {
+			return "Version mismatch " + mutation.key + ":" + std::to_string(entry->version);
+		}
+		entry->value = mutation.value;
+		break;
+	}
+
+	entry->version++;
+	if (!entry->dirty) {
+		entry->dirty = true;
+		dirty_.push_back(static_cast<size_t>(entry - entries_.data()));
+	}
+	return "";
+}
+
+bool hgs::StateStore::Flush(std::string& frame) {
+	std::lock_guard<std::mutex> lock(storeMtx_);
+	if (dirty_.empty()) return false;
+
+	frame = "{0|";
+	frame.push_back(storeCommand);
+	for (size_t i = 0; i < dirty_.size(); i++) {
+		Entry& entry = entries_[dirty_[i]];
+		if (i > 0) frame.push_back('|');
+		AppendEntry(frame, entry);
+		entry.dirty = false;
+	}
+	frame.push_back('}');
+	dirty_.clear();
+	return true;
+}
+
+std::string hgs::StateStore::Compose() const {
+	std::lock_guard<std::mutex> lock(storeMtx_);
+	if (size_ == 0) return "";
+
+	std::string frame = "{0|";
+	frame.push_back(storeCommand);
+	bool first = true;
+	for (auto& entry : entries_) {
+		if (!entry.used) continue;
+		if (!first) frame.push_back('|');
+		AppendEntry(frame, entry);
+		first = false;
+	}
+	frame.push_back('}');
+	return frame;
+}
+
+std::string hgs::StateStore::List() const {
+	std::lock_guard<std::mutex> lock(storeMtx_);
+
+	std::string result = "\nStore [" + std::to_string(size_) + "/" + std::to_string(maxKeys_) + "] keys";
+	for (auto& entry : entries_) {
+		if (entry.used) {
+			result.append("\n" + entry.key + " v" + std::to_string(entry.version) + " = " + entry.value);
+		}
+	}
+	return result;
+}
+
+hgs::StateStore::Entry* hgs::StateStore::Find(const std::string& key, const bool insert) {
+	if (entries_.empty()) return nullptr;
+
+	size_t index = std::hash<std::string>()(key) & mask_;
+	while (entries_[index].used) {
+		if (entries_[index].key == key) {
+			return &entries_[index];
+		}
+		index = (index + 1) & mask_;
+	}
+
+	// The table is never more than half full, so a free entry ends every probe
+	if (!insert || size_ >= maxKeys_) return nullptr;
+
+	Entry& entry = entries_[index];
+	entry.used = true;
+	entry.key = key;
+	size_++;
+	return &entry;
+}
+
+void hgs::StateStore::AppendEntry(std::string& frame, const Entry& entry) {
+	frame.append(entry.key);
+	frame.push_back(':');
+	frame.append(std::to_string(entry.version));
+	frame.push_back('=');
+	frame.append(entry.value);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Store.h
+	Purpose: Authoritative key/value state of a lobby. Clients mutate it
+	with API calls, the lobby applies the mutations in tick order and
+	broadcasts only the keys that changed
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	// Changed keys are broadcast as "{0|K<key>:<version>=<value>|...}",
+	// joining clients get every key in the same form
+	constexpr char storeCommand = 'K';
+
+	struct StoreMutation {
+		enum Operation {
+			set = 0,
+			increment = 1,
+			compare_and_swap = 2
+		};
+
+		Operation operation = set;
+		std::string key;
+		std::string value;
+		int64_t amount = 0;
+		// Version the key must have for a compare and swap, 0 for a missing key
+		uint64_t version = 0;
+
+		/**
+			Read "#set|key|value", "#inc|key|amount" or
+			"#cas|key|version|value", the amount is 1 if left out
+
+			@param segment Split API call
+			@param mutation Filled in on success
+			@return bool False if the call is malformed
+		 */
+		static bool Parse(const std::vector<std::string>& segment, StoreMutation& mutation);
+	};
+
+	/**
+		Open addressing table with linear probing. Keys are never
+		removed, so no tombstones are needed. The lobby thread
+		mutates and flushes, joining clients compose from other
+		threads under the same lock
+	 */
+	class StateStore {
+	public:
+		static constexpr size_t maxKeyLength = 32;
+		static constexpr size_t maxValueLength = 256;
+
+		/**
+			@param max_keys Keys the lobby may hold, 0 disables the store
+		 */
+		explicit StateStore(size_t max_keys);
+		/**
+			Apply one mutation, every change bumps
+			the version of the key
+
+			@param mutation Mutation from a client
+			@return std::string Reason it was rejected, empty on success
+		 */
+		std::string Apply(const StoreMutation& mutation);
+		/**
+			Compose the keys changed since the last flush
+
+			@param frame Set to the server frame
+			@return bool False if nothing changed
+		 */
+		bool Flush(std::string& frame);
+		/**
+			Compose every key, for clients joining the lobby
+
+			@return std::string Empty if the store holds no keys
+		 */
+		std::string Compose() const;
+		/**
+			Compose a listing of every key
+
+			@return std::string
+		 */
+		std::string List() const;
+
+		bool IsEnabled() const { return maxKeys_ > 0; };
+	private:
+		struct Entry {
+			std::string key;
+			std::string value;
+			uint64_t version = 0;
+			bool used = false;
+			bool dirty = false;
+		};
+
+		/**
+			Probe for a key
+
+			@param key The key
+			@param insert Claim a free entry if the key is missing
+			@return Entry* nullptr if missing, or if the store is full on insert
+		 */
+		Entry* Find(const std::string& key, bool insert);
+		static void AppendEntry(std::string& frame, const Entry& entry);
+
+		const size_t maxKeys_;
+		// Twice the key limit rounded up to a power of two, probes stay short
+		std::vector<Entry> entries_;
+		size_t mask_;
+		size_t size_;
+		// Entries changed since the last flush
+		std::vector<size_t> dirty_;
+
+		mutable std::mutex storeMtx_;
+	};
+
+}
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "trace.h"
+
+namespace {
+	// All buffers ever created, kept alive after their thread exits so they can still be dumped
+	std::mutex registryMtx;
+	std::vector<std::shared_ptr<hgs::trace::Buffer>> registry;
+	size_t nextThreadId = 1;
+
+	// Marks the owning buffer as dead when the thread exits
+	struct ThreadSlot {
+		std::shared_ptr<hgs::trace::Buffer> buffer;
+		std::string name = "Thread";
+
+		~ThreadSlot() {
+			if (buffer != nullptr) {
+				buffer->SetAlive(false);
+			}
+		}
+	};
+
+	thread_local ThreadSlot slot;
+
+	// Records between their check of the switch and the end of their push
+	std::atomic<int> recording(0);
+
+	// Turn recording off and wait for pushes that saw it on, buffers are only
+	// cleared or read once no thread writes to them
+	void Quiesce() {
+		hgs::trace::enabled = false;
+		while (recording.load() > 0) {
+			std::this_thread::yield();
+		}
+	}
+
+	hgs::trace::Buffer* LocalBuffer() {
+		if (slot.buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(registryMtx);
+			slot.buffer = std::make_shared<hgs::trace::Buffer>(slot.name, nextThreadId++);
+			registry.push_back(slot.buffer);
+		}
+		return slot.buffer.get();
+	}
+
+	void AppendEscaped(std::string& out, const std::string& string) {
+		for (char character : string) {
+			if (character == '"' || character == '\\') {
+				out.push_back('\\');
+			}
+			out.push_back(character);
+		}
+	}
+}
+
+std::atomic<bool> hgs::trace::enabled(false);
+
+hgs::trace::Buffer::Buffer(std::string thread_name, const size_t thread_id) :
+head_(0), alive_(true), threadName_(std::move(thread_name)), threadId_(thread_id) {
+}
+
+void hgs::trace::Buffer::Push(const char* name, const int64_t start, const int64_t duration, const int arg) {
+	const uint64_t head = head_.load(std::memory_order_relaxed);
+	events_[head % bufferSize] = { name, start, duration, arg };
+	head_.store(head + 1, std::memory_order_release);
+}
+
+void hgs::trace::Buffer::Clear() { head_.store(0, std::memory_order_release); }
+
+std::vector<hgs::trace::Event> hgs::trace::Buffer::GetEvents() const {
+	const uint64_t head = head_.load(std::memory_order_acquire);
+	const uint64_t count = std::min<uint64_t>(head, bufferSize);
+
+	std::vector<Event> events;
+	events.reserve(static_cast<size_t>(count));
+	// Oldest span first
+	for (uint64_t i = head - count; i < head; i++) {
+		events.push_back(events_[i % bufferSize]);
+	}
+	return events;
+}
+
+void hgs::trace::Buffer::SetAlive(const bool alive) { alive_ = alive; }
+
+int64_t hgs::trace::Now() {
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void hgs::trace::SetThreadName(const std::string& name) { slot.name = name; }
+
+void hgs::trace::Record(const char* name, const int64_t start, const int64_t duration, const int arg) {
+	// Only reached by scopes that started while tracing was on, a scope
+	// that ends after a stop is dropped
+	recording++;
+	if (enabled) {
+		LocalBuffer()->Push(name, start, duration, arg);
+	}
+	recording--;
+}
+
+void hgs::trace::Start() {
+	Quiesce();
+	std::lock_guard<std::mutex> lock(registryMtx);
+
+	// Forget buffers of threads that have exited since the last session
+	registry.erase(std::remove_if(registry.begin(), registry.end(), [](const std::shared_ptr<Buffer>& buffer) {
+		return !buffer->IsAlive();
+	}), registry.end());
+
+	for (auto& buffer : registry) {
+		buffer->Clear();
+	}
+	Now();
+	enabled = true;
+}
+
+void hgs::trace::Stop() { Quiesce(); }
+
+int hgs::trace::Dump(const std::string& path) {
+	// The buffers are still written to
+	if (enabled) {
+		return -2;
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		return -1;
+	}
+
+	std::vector<std::shared_ptr<Buffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(registryMtx);
+		buffers = registry;
+	}
+
+	int written = 0;
+	std::string out = "{\"traceEvents\":[";
+	bool first = true;
+
+	for (auto& buffer : buffers) {
+		const std::string tid = std::to_string(buffer->GetThreadId());
+
+		// Thread name metadata
+		out.append(first ? "\n" : ",\n");
+		first = false;
+		out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"");
+		AppendEscaped(out, buffer->GetThreadName());
+		out.append("\"}}");
+
+		for (const Event& event : buffer->GetEvents()) {
+			out.append(",\n{\"name\":\"");
+			AppendEscaped(out, event.name);
+			out.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+				",\"ts\":" + std::to_string(event.start) +
+				",\"dur\":" + std::to_string(event.duration) +
+				",\"args\":{\"id\":" + std::to_string(event.arg) + "}}");
+			written++;
+		}
+		file << out;
+		out.clear();
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	file.close();
+	return written;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Trace.h
+	Purpose: Opt-in span tracing of the lobby tick phases. Every thread
+	records into its own ring buffer and the result is dumped in the
+	Chrome trace event format (loadable in Perfetto or chrome://tracing)
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+	namespace trace {
+
+		// Number of spans each thread can hold before the oldest is overwritten
+		constexpr size_t bufferSize = 8192;
+
+		struct Event {
+			const char* name;
+			int64_t start;
+			int64_t duration;
+			int arg;
+		};
+
+		class Buffer {
+		public:
+			Buffer(std::string thread_name, size_t thread_id);
+			/**
+				Append a span to the ring, overwriting
+				the oldest span when the ring is full
+
+				@return void
+			 */
+			void Push(const char* name, int64_t start, int64_t duration, int arg);
+			/**
+				Discard all recorded spans
+
+				@return void
+			 */
+			void Clear();
+
+			// Getters
+			std::vector<Event> GetEvents() const;
+			const std::string& GetThreadName() const { return threadName_; };
+			size_t GetThreadId() const { return threadId_; };
+			bool IsAlive() const { return alive_; };
+
+			// Setters
+			void SetAlive(bool alive);
+		private:
+			std::array<Event, bufferSize> events_;
+			// Total number of spans pushed, the ring index is head_ % bufferSize
+			std::atomic<uint64_t> head_;
+			std::atomic<bool> alive_;
+
+			const std::string threadName_;
+			const size_t threadId_;
+		};
+
+		// Global switch, tested once per traced scope
+		extern std::atomic<bool> enabled;
+
+		/**
+			Microseconds since the first call, taken
+			from the monotonic clock
+
+			@return int64_t
+		 */
+		int64_t Now();
+		/**
+			Name the calling thread in the dumped trace,
+			call once when a thread starts
+
+			@param name Display name of the thread
+			@return void
+		 */
+		void SetThreadName(const std::string& name);
+		/**
+			Record a finished span in the calling
+			thread's ring buffer
+
+			@return void
+		 */
+		void Record(const char* name, int64_t start, int64_t duration, int arg);
+		/**
+			Stop any recording, clear all buffers
+			and start recording again
+
+			@return void
+		 */
+		void Start();
+		/**
+			Stop recording and wait for spans being
+			pushed, already recorded spans are kept
+			until the next start
+
+			@return void
+		 */
+		void Stop();
+		/**
+			Write all recorded spans to a file
+			in the Chrome trace event JSON format,
+			only while tracing is stopped
+
+			@param path Path of the output file
+			@return int Number of spans written, -1 if the file could not
+			be opened and -2 if tracing is still running
+		 */
+		int Dump(const std::string& path);
+
+		class Scope {
+		public:
+			explicit Scope(const char* name, const int arg = 0) : name_(name), arg_(arg), start_(-1) {
+				if (enabled.load(std::memory_order_relaxed)) {
+					start_ = Now();
+				}
+			}
+			~Scope() {
+				if (start_ >= 0) {
+					Record(name_, start_, Now() - start_, arg_);
+				}
+			}
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		private:
+			const char* name_;
+			const int arg_;
+			int64_t start_;
+		};
+	}
+}
+
+#define HGS_TRACE_CONCAT_INNER(a, b) a##b
+#define HGS_TRACE_CONCAT(a, b) HGS_TRACE_CONCAT_INNER(a, b)
+// Trace the rest of the enclosing scope as a span, the optional argument is shown as "id"
+#define HGS_TRACE_SCOPE(...) hgs::trace::Scope HGS_TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
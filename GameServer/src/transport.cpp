@@ -0,0 +1,27 @@
+#include "pch.h"
+#include "transport.h"
+
+hgs::SocketTransport::SocketTransport(const SOCKET socket) : socket_(socket) {
+}
+
+int hgs::SocketTransport::Receive(char* buffer, const int length) {
+	return recv(socket_, buffer, length, 0);
+}
+
+int hgs::SocketTransport::Send(const char* data, const int length) {
+	return send(socket_, data, length, 0);
+}
+
+bool hgs::SocketTransport::Ready() {
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(socket_, &readable);
+
+	// Poll without waiting, a closed connection is readable as well
+	timeval immediate = { 0, 0 };
+	return select(0, &readable, nullptr, nullptr, &immediate) != 0;
+}
+
+void hgs::SocketTransport::Close() {
+	closesocket(socket_);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Transport.h
+	Purpose: The byte pipe between a client object and its remote end.
+	Clients on the server talk to a TCP socket, in-process drivers plug
+	in memory pipes so the engine runs without real connections
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	class Transport {
+	public:
+		virtual ~Transport() = default;
+		/**
+			Receive one message from the remote end
+
+			@param buffer Destination of the message
+			@param length Size of the buffer
+			@return int Bytes received, 0 when the remote end closed
+			the connection and less than 0 when it was lost
+		 */
+		virtual int Receive(char* buffer, int length) = 0;
+		/**
+			Send a payload to the remote end
+
+			@param data First byte of the payload
+			@param length Bytes to send
+			@return int Bytes sent, less than 0 on failure
+		 */
+		virtual int Send(const char* data, int length) = 0;
+		/**
+			Whether Receive would return without waiting, a
+			lost connection counts as ready. Clients only call
+			Receive after the transport reported ready
+
+			@return bool
+		 */
+		virtual bool Ready() = 0;
+		/**
+			Move messages that are held back along,
+			called every client loop iteration
+
+			@return void
+		 */
+		virtual void Pump() {};
+		/**
+			Close the connection, called once
+			when the client is deleted
+
+			@return void
+		 */
+		virtual void Close() = 0;
+		/**
+			Handle identifying the connection in logs
+			and in the shared socket set
+
+			@return SOCKET
+		 */
+		virtual SOCKET GetHandle() const = 0;
+	};
+
+	class SocketTransport : public Transport {
+	public:
+		SocketTransport(SOCKET socket);
+
+		int Receive(char* buffer, int length) override;
+		int Send(const char* data, int length) override;
+		bool Ready() override;
+		void Close() override;
+		SOCKET GetHandle() const override { return socket_; };
+	private:
+		SOCKET socket_;
+	};
+
+}
@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "udp.h"
+#include "reliable.h"
+
+hgs::UdpGateway::UdpGateway() : socket_(INVALID_SOCKET), open_(false), received_(0), sent_(0), stale_(0) {
+}
+
+hgs::UdpGateway::~UdpGateway() {
+	Close();
+}
+
+int hgs::UdpGateway::Open(const unsigned short port) {
+	socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (socket_ == INVALID_SOCKET) {
+		return 1;
+	}
+
+	sockaddr_in hint = sockaddr_in();
+	hint.sin_family = AF_INET;
+	hint.sin_port = htons(port);
+	hint.sin_addr.S_un.S_addr = INADDR_ANY;
+	if (bind(socket_, reinterpret_cast<sockaddr*>(&hint), sizeof(hint)) == SOCKET_ERROR) {
+		closesocket(socket_);
+		socket_ = INVALID_SOCKET;
+		return 1;
+	}
+
+	// The loop drains the socket until it would block
+	u_long nonBlocking = 1;
+	ioctlsocket(socket_, FIONBIO, &nonBlocking);
+
+	open_ = true;
+	return 0;
+}
+
+void hgs::UdpGateway::Close() {
+	if (!open_.exchange(false)) return;
+	closesocket(socket_);
+}
+
+void hgs::UdpGateway::Loop() {
+	char buffer[maxDatagram + 64];
+
+	while (open_) {
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(socket_, &readable);
+		timeval wait = { 0, 10000 };
+		if (select(0, &readable, nullptr, nullptr, &wait) <= 0) {
+			continue;
+		}
+
+		// Everything that queued up is handled before waiting again
+		while (open_) {
+			sockaddr_in from = sockaddr_in();
+			int fromLength = sizeof(from);
+			const int bytes = recvfrom(socket_, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+			if (bytes <= 0) break;
+			received_++;
+			OnDatagram(buffer, bytes, from);
+		}
+	}
+}
+
+void hgs::UdpGateway::Register(const int id, const std::string& token) {
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	Endpoint endpoint;
+	endpoint.token = token;
+	endpoints_[id] = endpoint;
+}
+
+void hgs::UdpGateway::Forget(const int id) {
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	const auto endpoint = endpoints_.find(id);
+	if (endpoint == endpoints_.end()) return;
+
+	if (endpoint->second.bound) {
+		addresses_.erase(AddressKey(endpoint->second.address));
+	}
+	endpoints_.erase(endpoint);
+}
+
+bool hgs::UdpGateway::Take(const int id, std::string& payload) {
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	const auto endpoint = endpoints_.find(id);
+	if (endpoint == endpoints_.end() || !endpoint->second.pending) return false;
+
+	payload.swap(endpoint->second.latest);
+	endpoint->second.latest.clear();
+	endpoint->second.pending = false;
+	return true;
+}
+
+void hgs::UdpGateway::Send(const int id, const std::string& frames) {
+	// Take whole frames while they fit, a frame above the limit goes alone
+	std::vector<std::pair<size_t, size_t>> datagrams;
+	size_t start = 0;
+	while (start < frames.size()) {
+		size_t end = start;
+		while (end < frames.size()) {
+			const size_t close = frames.find('}', end);
+			const size_t next = (close == std::string::npos ? frames.size() : close + 1);
+			if (end > start && next - start > maxDatagram) break;
+			end = next;
+		}
+		datagrams.emplace_back(start, end);
+		start = end;
+	}
+
+	sockaddr_in address;
+	uint32_t sequence;
+	{
+		std::lock_guard<std::mutex> lock(endpointMtx_);
+		const auto endpoint = endpoints_.find(id);
+		if (endpoint == endpoints_.end() || !endpoint->second.bound) return;
+		address = endpoint->second.address;
+		sequence = endpoint->second.sequenceOut;
+		endpoint->second.sequenceOut += static_cast<uint32_t>(datagrams.size());
+	}
+
+	std::string datagram;
+	for (auto& range : datagrams) {
+		datagram.clear();
+		datagram.push_back(datagramState);
+		datagram.append(std::to_string(++sequence));
+		datagram.push_back('|');
+		datagram.append(frames, range.first, range.second - range.first);
+		SendTo(address, datagram.c_str(), static_cast<int>(datagram.size()));
+	}
+}
+
+void hgs::UdpGateway::TakeReliable(const int id, std::vector<std::string>& datagrams) {
+	datagrams.clear();
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	const auto endpoint = endpoints_.find(id);
+	if (endpoint == endpoints_.end()) return;
+	datagrams.swap(endpoint->second.reliable);
+}
+
+void hgs::UdpGateway::SendRaw(const int id, const std::string& datagram) {
+	sockaddr_in address;
+	{
+		std::lock_guard<std::mutex> lock(endpointMtx_);
+		const auto endpoint = endpoints_.find(id);
+		if (endpoint == endpoints_.end() || !endpoint->second.bound) return;
+		address = endpoint->second.address;
+	}
+	SendTo(address, datagram.c_str(), static_cast<int>(datagram.size()));
+}
+
+bool hgs::UdpGateway::IsBound(const int id) const {
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	const auto endpoint = endpoints_.find(id);
+	return endpoint != endpoints_.end() && endpoint->second.bound;
+}
+
+std::string hgs::UdpGateway::ToString() const {
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+	return "Udp " + std::to_string(addresses_.size()) + " bound, " + std::to_string(received_) + " received, " +
+		std::to_string(sent_) + " sent, " + std::to_string(stale_) + " stale";
+}
+
+void hgs::UdpGateway::OnDatagram(const char* data, const int length, const sockaddr_in& from) {
+	if (length < 3) return;
+	const std::string datagram(data, static_cast<size_t>(length));
+
+	std::lock_guard<std::mutex> lock(endpointMtx_);
+
+	if (datagram[0] == datagramBind) {
+		const size_t separator = datagram.find('|');
+		if (separator == std::string::npos) return;
+		const int id = atoi(datagram.c_str() + 1);
+		const auto endpoint = endpoints_.find(id);
+		if (endpoint == endpoints_.end() || endpoint->second.token.empty() ||
+			datagram.compare(separator + 1, std::string::npos, endpoint->second.token) != 0) {
+			return;
+		}
+
+		// Rebinding moves the client to its new address
+		if (endpoint->second.bound) {
+			addresses_.erase(AddressKey(endpoint->second.address));
+		}
+		const auto previous = addresses_.find(AddressKey(from));
+		if (previous != addresses_.end() && previous->second != id) {
+			endpoints_[previous->second].bound = false;
+		}
+		endpoint->second.address = from;
+		endpoint->second.bound = true;
+		addresses_[AddressKey(from)] = id;
+
+		const char ack = datagramBind;
+		SendTo(from, &ack, 1);
+		return;
+	}
+
+	const auto address = addresses_.find(AddressKey(from));
+	if (address == addresses_.end()) return;
+	Endpoint& endpoint = endpoints_[address->second];
+
+	// The client parses these, an endpoint that doesn't keep up loses them and they are resent
+	if (datagram[0] == datagramReliable || datagram[0] == datagramAck) {
+		if (endpoint.reliable.size() < maxReliableBacklog) {
+			endpoint.reliable.push_back(datagram);
+		}
+		return;
+	}
+
+	const size_t separator = datagram.find('|');
+	if (datagram[0] != datagramState || separator == std::string::npos) return;
+
+	// Sequence numbers wrap, anything not ahead of the last one is out of date
+	const uint32_t sequence = static_cast<uint32_t>(strtoul(datagram.c_str() + 1, nullptr, 10));
+	if (static_cast<int32_t>(sequence - endpoint.sequenceIn) <= 0) {
+		stale_++;
+		return;
+	}
+	endpoint.sequenceIn = sequence;
+
+	// A NUL ends the frame in every recipient's payload, what follows it could pass as
+	// another client's frame. The size is left to the ingress limits like on TCP
+	if (datagram.find('\0', separator + 1) != std::string::npos) return;
+	if (endpoint.pending) {
+		stale_++;
+	}
+	endpoint.latest.assign(datagram, separator + 1, std::string::npos);
+	endpoint.pending = true;
+}
+
+void hgs::UdpGateway::SendTo(const sockaddr_in& address, const char* data, const int length) {
+	sent_++;
+	sendto(socket_, data, length, 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
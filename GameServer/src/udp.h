@@ -0,0 +1,137 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Udp.h
+	Purpose: Optional datagram path next to the TCP connection of every
+	client. Unreliable, sequenced state frames travel on it so a lost
+	segment never holds back later state, TCP keeps control and
+	reliable traffic
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	/**
+		Datagrams start with a type character:
+		"B<id>|<token>" binds the sender address to a client, answered with "B"
+		"S<sequence>|<frames>" carries state, older sequences are dropped
+		"R..." and "A..." belong to the reliable channel of the client
+	 */
+	constexpr char datagramBind = 'B';
+	constexpr char datagramState = 'S';
+
+	/**
+		One socket bound on the server port. A dedicated
+		thread drains every datagram that is ready before
+		waiting again, client threads send their datagrams
+		once per tick
+	 */
+	class UdpGateway {
+	public:
+		// Payload of one datagram, frames are never split to stay under common MTUs
+		static constexpr size_t maxDatagram = 1200;
+		// Reliable datagrams held for a client that hasn't picked them up
+		static constexpr size_t maxReliableBacklog = 256;
+
+		UdpGateway();
+		~UdpGateway();
+		/**
+			Bind the datagram socket
+
+			@param port Port to bind, the same number as the TCP listener
+			@return int 0 on success
+		 */
+		int Open(unsigned short port);
+		void Close();
+		/**
+			Receive datagrams until the gateway is closed
+
+			@return void
+		 */
+		void Loop();
+		/**
+			Let a client bind an address with its session token
+
+			@param id Client id
+			@param token Token from the welcome message
+			@return void
+		 */
+		void Register(int id, const std::string& token);
+		void Forget(int id);
+		/**
+			Take the newest state frame a client sent
+			since the last call, later frames replace
+			earlier ones that were never taken
+
+			@param id Client id
+			@param payload Receives the frame
+			@return bool False if nothing new arrived
+		 */
+		bool Take(int id, std::string& payload);
+		/**
+			Send frames to the bound address of a client,
+			split at frame borders into numbered datagrams
+
+			@param id Client id
+			@param frames Concatenated "{id|...}" frames
+			@return void
+		 */
+		void Send(int id, const std::string& frames);
+		/**
+			Take the reliable channel datagrams a client
+			sent since the last call, in arrival order
+
+			@param id Client id
+			@param datagrams Cleared and filled
+			@return void
+		 */
+		void TakeReliable(int id, std::vector<std::string>& datagrams);
+		/**
+			Send one datagram as is to the bound address of a client
+
+			@param id Client id
+			@param datagram Complete datagram
+			@return void
+		 */
+		void SendRaw(int id, const std::string& datagram);
+
+		bool IsOpen() const { return open_; };
+		bool IsBound(int id) const;
+		std::string ToString() const;
+	private:
+		struct Endpoint {
+			std::string token;
+			sockaddr_in address = sockaddr_in();
+			bool bound = false;
+			uint32_t sequenceIn = 0;
+			uint32_t sequenceOut = 0;
+			std::string latest;
+			bool pending = false;
+			std::vector<std::string> reliable;
+		};
+
+		void OnDatagram(const char* data, int length, const sockaddr_in& from);
+		void SendTo(const sockaddr_in& address, const char* data, int length);
+		static uint64_t AddressKey(const sockaddr_in& address) {
+			return static_cast<uint64_t>(address.sin_addr.s_addr) << 16 | address.sin_port;
+		};
+
+		SOCKET socket_;
+		std::atomic<bool> open_;
+
+		std::unordered_map<int, Endpoint> endpoints_;
+		// Bound addresses, datagrams from anywhere else are ignored
+		std::unordered_map<uint64_t, int> addresses_;
+		mutable std::mutex endpointMtx_;
+
+		// Counters
+		std::atomic<uint64_t> received_;
+		std::atomic<uint64_t> sent_;
+		// Out of date or never taken state frames
+		std::atomic<uint64_t> stale_;
+	};
+
+}
@@ -9,3 +9,39 @@ bool hgs::utilities::IsInt(std::string& string) {
 	}
 	catch (...) { return false; }
 }		
+
+int64_t hgs::utilities::NowMicroseconds() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void hgs::utilities::WriteStamp(char* destination, int64_t microseconds) {
+	for (size_t i = stampDigits; i > 0; i--) {
+		destination[i - 1] = static_cast<char>('0' + microseconds % 10);
+		microseconds /= 10;
+	}
+}
+
+size_t hgs::utilities::ReadTargets(const std::string& frame, const size_t at, std::vector<int>& targets) {
+	targets.clear();
+	if (frame.compare(at, 3, targetHeader) != 0) return 0;
+
+	const char* current = frame.c_str() + at + 3;
+	while (true) {
+		char* end = nullptr;
+		const long target = std::strtol(current, &end, 10);
+		if (end == current || target <= 0 || target > std::numeric_limits<int>::max() || targets.size() >= maxTargets) {
+			targets.clear();
+			return 0;
+		}
+		targets.push_back(static_cast<int>(target));
+
+		if (*end == '@') {
+			return static_cast<size_t>(end - frame.c_str()) + 1;
+		}
+		if (*end != ',') {
+			targets.clear();
+			return 0;
+		}
+		current = end + 1;
+	}
+}
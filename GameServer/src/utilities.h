@@ -1,9 +1,36 @@
 #pragma once
 #include "pch.h"
+#include "message.h"
 
 namespace hgs {
 	namespace utilities {
 		bool IsInt(std::string& string);
+		/**
+			Monotonic time in microseconds, used for
+			timestamps that are compared between threads
+
+			@return int64_t
+		 */
+		int64_t NowMicroseconds();
+		/**
+			Write a timestamp as zero padded decimal
+			digits, exactly stampDigits characters
+
+			@param destination First character to overwrite
+			@param microseconds The timestamp
+			@return void
+		 */
+		void WriteStamp(char* destination, int64_t microseconds);
+		/**
+			Read the target header of an addressed frame
+
+			@param frame Payload as sent by the client
+			@param at Offset of the header
+			@param targets Filled with the client ids
+			@return size_t Offset of the first character after the header,
+			0 if the header is malformed, empty or lists more than maxTargets ids
+		 */
+		size_t ReadTargets(const std::string& frame, size_t at, std::vector<int>& targets);
 	}
 
 	
@@ -40,5 +67,48 @@ namespace hgs {
 		bool lobbySessionLogging = NULL;
 		int lobbyStartIdAt = NULL;
 		int clientStartIdAt = NULL;
+		int latencySampleRate = NULL;
+		int pingInterval = NULL;
+		int pingTimeout = NULL;
+		bool lobbyAdaptiveTimeout = NULL;
+		int lobbyMaxChannels = NULL;
+		bool lobbyCoalesce = NULL;
+		bool decimationEnable = NULL;
+		int decimationMaxInterval = NULL;
+		int decimationRtt = NULL;
+		int ingressMaxFrame = NULL;
+		int ingressMessagesPerSecond = NULL;
+		int ingressBytesPerSecond = NULL;
+		int ingressThrottleAfter = NULL;
+		int ingressKickAfter = NULL;
+		int admissionMaxPerAddress = NULL;
+		int admissionPerMinute = NULL;
+		int admissionBurst = NULL;
+		std::string admissionBlocklist;
+		float interestCellSize = NULL;
+		float interestRadius = NULL;
+		bool snapshotEnable = NULL;
+		int snapshotTicks = NULL;
+		int storeMaxKeys = NULL;
+		int resumeGrace = NULL;
+		int resumeBufferTicks = NULL;
+		bool udpEnable = NULL;
+		bool localEnable = NULL;
+		std::string localPath;
+		bool webSocketEnable = NULL;
+		int webSocketPort = NULL;
+		bool impairmentEnable = NULL;
+		int impairmentLatency = NULL;
+		int impairmentJitter = NULL;
+		int impairmentBandwidth = NULL;
+		float impairmentReorder = NULL;
+		float impairmentStallChance = NULL;
+		int impairmentStallDuration = NULL;
+		unsigned int impairmentSeed = NULL;
+		bool deltaEnable = NULL;
+		int deltaKeyframeInterval = NULL;
+		bool compressionEnable = NULL;
+		int compressionThreshold = NULL;
+		std::string compressionDictionary;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,392 @@
+#include "pch.h"
+#include "websocket.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define HGS_SSE2
+#endif
+
+namespace {
+	uint32_t RotateLeft(const uint32_t value, const int bits) {
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	std::string Sha1(const std::string& data) {
+		uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+		std::string message = data;
+		const uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+		message.push_back('\x80');
+		while (message.size() % 64 != 56) {
+			message.push_back('\0');
+		}
+		for (int i = 7; i >= 0; i--) {
+			message.push_back(static_cast<char>(bits >> (i * 8)));
+		}
+
+		for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+			uint32_t w[80];
+			for (int i = 0; i < 16; i++) {
+				const auto* bytes = reinterpret_cast<const uint8_t*>(message.data() + chunk + i * 4);
+				w[i] = static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+			}
+			for (int i = 16; i < 80; i++) {
+				w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+			}
+
+			uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+			for (int i = 0; i < 80; i++) {
+				uint32_t f, k;
+				if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+				else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+				else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+				else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+				const uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+				e = d;
+				d = c;
+				c = RotateLeft(b, 30);
+				b = a;
+				a = temp;
+			}
+			h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+		}
+
+		std::string digest;
+		for (uint32_t word : h) {
+			for (int i = 3; i >= 0; i--) {
+				digest.push_back(static_cast<char>(word >> (i * 8)));
+			}
+		}
+		return digest;
+	}
+
+	std::string Base64(const std::string& data) {
+		static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string result;
+		for (size_t i = 0; i < data.size(); i += 3) {
+			uint32_t group = static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << 16;
+			if (i + 1 < data.size()) group |= static_cast<uint32_t>(static_cast<uint8_t>(data[i + 1])) << 8;
+			if (i + 2 < data.size()) group |= static_cast<uint8_t>(data[i + 2]);
+			result.push_back(alphabet[(group >> 18) & 63]);
+			result.push_back(alphabet[(group >> 12) & 63]);
+			result.push_back(i + 1 < data.size() ? alphabet[(group >> 6) & 63] : '=');
+			result.push_back(i + 2 < data.size() ? alphabet[group & 63] : '=');
+		}
+		return result;
+	}
+
+	// Value of a header line, found case insensitively, with surrounding spaces trimmed
+	std::string HeaderValue(const std::string& request, const std::string& lower, const std::string& name) {
+		const size_t line = lower.find("\r\n" + name + ":");
+		if (line == std::string::npos) return "";
+
+		size_t start = line + name.size() + 3;
+		size_t end = request.find("\r\n", start);
+		if (end == std::string::npos) end = request.size();
+		while (start < end && request[start] == ' ') start++;
+		while (end > start && request[end - 1] == ' ') end--;
+		return request.substr(start, end - start);
+	}
+}
+
+hgs::WebSocketTransport::WebSocketTransport(const SOCKET socket, const size_t max_message) : socket_(socket), maxMessage_(max_message), upgraded_(false), closed_(false), closedWith_(0), continuing_(false), frontAt_(0) {
+}
+
+int hgs::WebSocketTransport::Receive(char* buffer, const int length) {
+	// Clients only call this after Ready, wait like a blocking recv otherwise
+	while (messages_.empty() && !closed_) {
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(socket_, &readable);
+		timeval wait = { 0, 10000 };
+		select(0, &readable, nullptr, nullptr, &wait);
+		Fill();
+	}
+	if (messages_.empty()) return closedWith_;
+
+	// Longer messages than the buffer go out in pieces without a NUL,
+	// the client joins them like a message cut by a TCP read
+	const std::string& message = messages_.front();
+	const size_t left = message.size() - frontAt_;
+	if (left >= static_cast<size_t>(length)) {
+		memcpy(buffer, message.data() + frontAt_, static_cast<size_t>(length));
+		frontAt_ += static_cast<size_t>(length);
+		return length;
+	}
+	memcpy(buffer, message.data() + frontAt_, left);
+	buffer[left] = '\0';
+	messages_.pop_front();
+	frontAt_ = 0;
+	return static_cast<int>(left) + 1;
+}
+
+int hgs::WebSocketTransport::Send(const char* data, int length) {
+	// Frames mark where a message ends, the terminator is left out
+	if (length > 0 && data[length - 1] == '\0') {
+		length--;
+	}
+	return SendFrame(opcode_binary, data, static_cast<size_t>(length));
+}
+
+bool hgs::WebSocketTransport::Ready() {
+	Fill();
+	return closed_ || !messages_.empty();
+}
+
+void hgs::WebSocketTransport::Pump() {
+	if (!upgraded_) {
+		Fill();
+	}
+}
+
+void hgs::WebSocketTransport::Close() {
+	if (upgraded_ && !closed_) {
+		Fail(1001);
+	}
+	closed_ = true;
+	closesocket(socket_);
+}
+
+size_t hgs::WebSocketTransport::WriteHeader(char* header, const Opcode opcode, const uint64_t length) {
+	header[0] = static_cast<char>(0x80 | opcode);
+	if (length < 126) {
+		header[1] = static_cast<char>(length);
+		return 2;
+	}
+	if (length <= 0xFFFF) {
+		header[1] = 126;
+		header[2] = static_cast<char>(length >> 8);
+		header[3] = static_cast<char>(length);
+		return 4;
+	}
+	header[1] = 127;
+	for (int i = 0; i < 8; i++) {
+		header[2 + i] = static_cast<char>(length >> (56 - 8 * i));
+	}
+	return 10;
+}
+
+void hgs::WebSocketTransport::Unmask(char* data, const size_t length, const uint8_t mask[4]) {
+	size_t i = 0;
+#ifdef HGS_SSE2
+	// Blocks of 16 start at multiples of 4, so the key lines up with every block
+	uint8_t pattern[16];
+	for (size_t j = 0; j < 16; j++) {
+		pattern[j] = mask[j & 3];
+	}
+	const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+	for (; i + 16 <= length; i += 16) {
+		__m128i* block = reinterpret_cast<__m128i*>(data + i);
+		_mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), key));
+	}
+#endif
+	for (; i < length; i++) {
+		data[i] = static_cast<char>(data[i] ^ mask[i & 3]);
+	}
+}
+
+std::string hgs::WebSocketTransport::AcceptKey(const std::string& key) {
+	return Base64(Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+}
+
+int hgs::WebSocketTransport::Handshake(const std::string& data, std::string& response, size_t& used) {
+	const size_t end = data.find("\r\n\r\n");
+	if (end == std::string::npos) {
+		if (data.size() <= maxRequest) return 0;
+		response = "HTTP/1.1 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+		return -1;
+	}
+	used = end + 4;
+
+	const std::string request = data.substr(0, end + 2);
+	std::string lower = request;
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](const char character) {
+		return static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+	});
+
+	std::string upgrade = HeaderValue(lower, lower, "upgrade");
+	const std::string key = HeaderValue(request, lower, "sec-websocket-key");
+	if (lower.compare(0, 4, "get ") != 0 || upgrade.find("websocket") == std::string::npos || key.empty()) {
+		response = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+		return -1;
+	}
+
+	response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + AcceptKey(key) + "\r\n\r\n";
+	return 1;
+}
+
+void hgs::WebSocketTransport::Fill() {
+	if (closed_) return;
+
+	// Drain what arrived, a frame of any size is decoded on the first call after it is complete
+	const size_t before = inbound_.size();
+	bool lost = false;
+	while (inbound_.size() < maxMessage_ + maxRequest) {
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(socket_, &readable);
+		timeval immediate = { 0, 0 };
+		if (select(0, &readable, nullptr, nullptr, &immediate) <= 0) break;
+
+		char buffer[16384];
+		const int bytes = recv(socket_, buffer, sizeof(buffer), 0);
+		if (bytes <= 0) {
+			lost = true;
+			closedWith_ = bytes < 0 ? -1 : 0;
+			break;
+		}
+		inbound_.append(buffer, static_cast<size_t>(bytes));
+	}
+	if (inbound_.size() == before) {
+		closed_ = lost;
+		return;
+	}
+
+	if (!upgraded_) {
+		std::string response;
+		size_t used = 0;
+		const int result = Handshake(inbound_, response, used);
+		if (result == 0) {
+			closed_ = lost;
+			return;
+		}
+
+		send(socket_, response.c_str(), static_cast<int>(response.size()), 0);
+		if (result < 0) {
+			closed_ = true;
+			return;
+		}
+
+		upgraded_ = true;
+		inbound_.erase(0, used);
+		if (!queued_.empty()) {
+			send(socket_, queued_.c_str(), static_cast<int>(queued_.size()), 0);
+			queued_.clear();
+		}
+	}
+
+	// Frames that arrived ahead of a lost connection are still delivered
+	const uint16_t code = Decode();
+	if (code != 0) {
+		Fail(code);
+	}
+	closed_ = closed_ || lost;
+}
+
+uint16_t hgs::WebSocketTransport::Decode() {
+	size_t at = 0;
+	uint16_t code = 0;
+
+	while (code == 0 && !closed_ && inbound_.size() - at >= 2) {
+		const auto first = static_cast<uint8_t>(inbound_[at]);
+		const auto second = static_cast<uint8_t>(inbound_[at + 1]);
+		const bool fin = (first & 0x80) != 0;
+		const uint8_t opcode = first & 0x0F;
+
+		// No extensions are negotiated and clients always mask
+		if ((first & 0x70) != 0 || (second & 0x80) == 0) {
+			code = 1002;
+			break;
+		}
+
+		size_t header = 2;
+		uint64_t length = second & 0x7F;
+		if (length == 126) {
+			if (inbound_.size() - at < 4) break;
+			length = static_cast<uint64_t>(static_cast<uint8_t>(inbound_[at + 2])) << 8 | static_cast<uint8_t>(inbound_[at + 3]);
+			header = 4;
+		}
+		else if (length == 127) {
+			if (inbound_.size() - at < 10) break;
+			length = 0;
+			for (int i = 0; i < 8; i++) {
+				length = length << 8 | static_cast<uint8_t>(inbound_[at + 2 + i]);
+			}
+			header = 10;
+		}
+		if (length > maxMessage_) {
+			code = 1009;
+			break;
+		}
+		header += 4;
+		if (inbound_.size() - at < header + length) break;
+
+		// Unmasked in place, the payload is only copied into its message
+		char* payload = &inbound_[at + header];
+		Unmask(payload, static_cast<size_t>(length), reinterpret_cast<const uint8_t*>(&inbound_[at + header - 4]));
+
+		switch (opcode) {
+		case opcode_continuation:
+		case opcode_text:
+		case opcode_binary:
+			if ((opcode == opcode_continuation) != continuing_) {
+				code = 1002;
+				break;
+			}
+			partial_.append(payload, static_cast<size_t>(length));
+			if (partial_.size() > maxMessage_) {
+				code = 1009;
+				break;
+			}
+			continuing_ = !fin;
+			if (fin) {
+				messages_.push_back(std::move(partial_));
+				partial_.clear();
+			}
+			break;
+		case opcode_ping:
+			if (!fin || length > 125) {
+				code = 1002;
+				break;
+			}
+			SendFrame(opcode_pong, payload, static_cast<size_t>(length));
+			break;
+		case opcode_pong:
+			break;
+		case opcode_close:
+			// Echo the status code and stop reading
+			SendFrame(opcode_close, payload, std::min<size_t>(static_cast<size_t>(length), 2));
+			closed_ = true;
+			break;
+		default:
+			code = 1002;
+			break;
+		}
+
+		at += header + static_cast<size_t>(length);
+	}
+
+	inbound_.erase(0, at);
+	return code;
+}
+
+int hgs::WebSocketTransport::SendFrame(const Opcode opcode, const char* data, const size_t length) {
+	if (closed_) return -1;
+
+	char header[10];
+	const size_t headerLength = WriteHeader(header, opcode, length);
+
+	if (!upgraded_) {
+		queued_.append(header, headerLength);
+		queued_.append(data, length);
+		return static_cast<int>(length);
+	}
+
+	// Header and payload in one gathered write, the payload is never copied
+	WSABUF buffers[2];
+	buffers[0].len = static_cast<ULONG>(headerLength);
+	buffers[0].buf = header;
+	buffers[1].len = static_cast<ULONG>(length);
+	buffers[1].buf = const_cast<char*>(data);
+	DWORD sent = 0;
+	if (WSASend(socket_, buffers, length > 0 ? 2 : 1, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+		return -1;
+	}
+	return static_cast<int>(length);
+}
+
+void hgs::WebSocketTransport::Fail(const uint16_t code) {
+	const char payload[2] = { static_cast<char>(code >> 8), static_cast<char>(code & 0xFF) };
+	SendFrame(opcode_close, payload, sizeof(payload));
+	closed_ = true;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "pch.h"
+#include "transport.h"
+
+/**
+	WebSocket.h
+	Purpose: Transport for browser clients. Speaks the HTTP upgrade
+	handshake and RFC 6455 framing, every frame carries one message of
+	the normal protocol without the NUL terminator
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	class WebSocketTransport : public Transport {
+	public:
+		// Larger upgrade requests are refused
+		static constexpr size_t maxRequest = 8192;
+
+		enum Opcode {
+			opcode_continuation = 0x0,
+			opcode_text = 0x1,
+			opcode_binary = 0x2,
+			opcode_close = 0x8,
+			opcode_ping = 0x9,
+			opcode_pong = 0xA
+		};
+
+		/**
+			@param socket Accepted connection, still expecting the upgrade
+			@param max_message Larger messages close the connection with 1009,
+			the same limit a client puts on a message split across TCP reads
+		 */
+		WebSocketTransport(SOCKET socket, size_t max_message);
+
+		/**
+			Take one complete message, copied into the
+			buffer with a NUL after it like a TCP message,
+			a message that doesn't fit is handed out in
+			pieces and only the last one has the NUL
+
+			@return int Bytes including the NUL, 0 once the connection
+			closed and less than 0 if it broke
+		 */
+		int Receive(char* buffer, int length) override;
+		/**
+			Send a payload as one binary frame, the header and
+			the payload leave in one gathered write without
+			copying the payload. Frames sent before the
+			handshake finished are queued
+
+			@param data Payload, a trailing NUL is not sent
+			@param length Bytes of the payload
+			@return int Bytes sent, less than 0 on failure
+		 */
+		int Send(const char* data, int length) override;
+		bool Ready() override;
+		/**
+			Move the upgrade handshake along
+
+			@return void
+		 */
+		void Pump() override;
+		void Close() override;
+		SOCKET GetHandle() const override { return socket_; };
+
+		/**
+			Write a server frame header, servers never mask
+
+			@param header At least 10 bytes
+			@param opcode Frame type
+			@param length Payload bytes
+			@return size_t Bytes written
+		 */
+		static size_t WriteHeader(char* header, Opcode opcode, uint64_t length);
+		/**
+			XOR a payload with its masking key in place, 16
+			bytes at a time where SSE2 is available
+
+			@param data Payload
+			@param length Bytes
+			@param mask Masking key of the frame
+			@return void
+		 */
+		static void Unmask(char* data, size_t length, const uint8_t mask[4]);
+		/**
+			Sec-WebSocket-Accept value for a client key
+
+			@param key Sec-WebSocket-Key of the request
+			@return std::string Base64 SHA-1 of the key and the RFC 6455 GUID
+		 */
+		static std::string AcceptKey(const std::string& key);
+		/**
+			Answer the upgrade request at the start of data
+
+			@param data Bytes received so far
+			@param response Set to the HTTP response once the request is complete
+			@param used Set to the bytes the request took
+			@return int 1 on upgrade, 0 if the request is incomplete, -1 if it is refused
+		 */
+		static int Handshake(const std::string& data, std::string& response, size_t& used);
+	private:
+		/**
+			Read what the socket holds without waiting
+			and decode every complete frame
+
+			@return void
+		 */
+		void Fill();
+		/**
+			Decode frames at the front of inbound_
+
+			@return uint16_t 0, or the close code of a protocol error
+		 */
+		uint16_t Decode();
+		int SendFrame(Opcode opcode, const char* data, size_t length);
+		void Fail(uint16_t code);
+
+		SOCKET socket_;
+		size_t maxMessage_;
+		bool upgraded_;
+		bool closed_;
+		// What Receive returns once closed, below 0 if the connection broke instead of closing
+		int closedWith_;
+
+		// Bytes read but not yet decoded
+		std::string inbound_;
+		// Message being put together from continuation frames
+		std::string partial_;
+		bool continuing_;
+		std::deque<std::string> messages_;
+		// Bytes of the front message already handed out
+		size_t frontAt_;
+		// Frames sent before the upgrade finished
+		std::string queued_;
+	};
+
+}
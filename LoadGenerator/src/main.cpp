@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "swarm.h"
+
+using namespace hgs;
+
+/**
+	main.cpp
+	Purpose: Load generator entry point. Parses the command line,
+	starts winsock2 and runs a swarm of synthetic clients against
+	a running server
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace {
+	void PrintUsage() {
+		std::cout <<
+			"Usage: LoadGenerator [options]\n\n\
+   --host <ip>             Server address (default 127.0.0.1)\n\
+   --port <port>           Server port (default 15000)\n\
+   --clients <n>           Connections to open (default 100)\n\
+   --connect-rate <n>      New connections per second (default 200)\n\
+   --rate <n>              Payloads per second and client (default 20)\n\
+   --size <bytes>          Payload size, below 1024 (default 64)\n\
+   --duration <s>          Seconds to run (default 30)\n\
+   --lobbies <a,b,...>     Lobbies to spread clients over with #join\n\
+   --move-interval <s>     Mean seconds between lobby moves per client (default off)\n\
+   --report <s>            Seconds between progress lines (default 5)\n\
+   --json <file>           Write the final report as JSON\n\
+   --seed <n>              Seed for send offsets and lobby moves (default 1)\n";
+	}
+
+	std::vector<std::string> SplitList(const std::string& list) {
+		std::vector<std::string> parts;
+		size_t start = 0;
+		while (start <= list.size()) {
+			const size_t end = std::min(list.find(',', start), list.size());
+			if (end > start) {
+				parts.push_back(list.substr(start, end - start));
+			}
+			start = end + 1;
+		}
+		return parts;
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	SwarmSettings settings;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string option = argv[i];
+		if (option == "--help" || option == "-h") {
+			PrintUsage();
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << option << std::endl;
+			PrintUsage();
+			return 1;
+		}
+
+		const std::string value = argv[++i];
+		try {
+			if (option == "--host") settings.host = value;
+			else if (option == "--port") settings.port = std::stoi(value);
+			else if (option == "--clients") settings.clients = std::stoi(value);
+			else if (option == "--connect-rate") settings.connectRate = std::stoi(value);
+			else if (option == "--rate") settings.sendRate = std::stod(value);
+			else if (option == "--size") settings.payloadSize = std::stoi(value);
+			else if (option == "--duration") settings.duration = std::stoi(value);
+			else if (option == "--lobbies") settings.lobbies = SplitList(value);
+			else if (option == "--move-interval") settings.moveInterval = std::stod(value);
+			else if (option == "--report") settings.reportInterval = std::stoi(value);
+			else if (option == "--json") settings.jsonPath = value;
+			else if (option == "--seed") settings.seed = static_cast<unsigned int>(std::stoul(value));
+			else {
+				std::cerr << "Unknown option " << option << std::endl;
+				PrintUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			std::cerr << "Bad value for " << option << ": " << value << std::endl;
+			return 1;
+		}
+	}
+
+	// The server reads client messages into a 1024 byte buffer
+	if (settings.payloadSize >= 1024) {
+		std::cerr << "Payload size must be below 1024 bytes" << std::endl;
+		return 1;
+	}
+
+	WSADATA data;
+	const int wsOk = WSAStartup(MAKEWORD(2, 2), &data);
+	if (wsOk != 0) {
+		std::cerr << "Can't initialize winsock2, Err #" << wsOk << std::endl;
+		return 1;
+	}
+
+	int result;
+	{
+		Swarm swarm(settings);
+		result = swarm.Run();
+	}
+
+	WSACleanup();
+	return result;
+}
@@ -0,0 +1,19 @@
+#pragma once
+// Standard libraries
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <array>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib,"WS2_32")
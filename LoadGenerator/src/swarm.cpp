@@ -0,0 +1,496 @@
+#include "pch.h"
+#include "swarm.h"
+
+hgs::LatencyRecorder::LatencyRecorder() : buckets_(64 * subBuckets, 0), count_(0), max_(0), sum_(0.0) {
+}
+
+size_t hgs::LatencyRecorder::Index(const int64_t value) {
+	if (value < subBuckets) {
+		return static_cast<size_t>(std::max<int64_t>(value, 0));
+	}
+	// Keep the subBits + 1 highest bits, the top one is implicit
+	int shift = 0;
+	while ((value >> (shift + subBits + 1)) != 0) {
+		shift++;
+	}
+	const int64_t sub = (value >> shift) - subBuckets;
+	return static_cast<size_t>((shift + 1) * subBuckets + sub);
+}
+
+int64_t hgs::LatencyRecorder::UpperBound(const size_t index) {
+	if (index < static_cast<size_t>(subBuckets)) {
+		return static_cast<int64_t>(index);
+	}
+	const int shift = static_cast<int>(index / subBuckets) - 1;
+	const int64_t sub = static_cast<int64_t>(index % subBuckets);
+	return ((subBuckets + sub + 1) << shift) - 1;
+}
+
+void hgs::LatencyRecorder::Add(const int64_t microseconds) {
+	const size_t index = std::min(Index(microseconds), buckets_.size() - 1);
+	buckets_[index]++;
+	count_++;
+	sum_ += static_cast<double>(microseconds);
+	max_ = std::max(max_, microseconds);
+}
+
+int64_t hgs::LatencyRecorder::Percentile(const double percentile) const {
+	if (count_ == 0) return 0;
+
+	const uint64_t target = static_cast<uint64_t>(percentile * static_cast<double>(count_ - 1)) + 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets_.size(); i++) {
+		seen += buckets_[i];
+		if (seen >= target) {
+			return std::min(UpperBound(i), max_);
+		}
+	}
+	return max_;
+}
+
+hgs::Swarm::Swarm(const SwarmSettings& settings) : settings_(settings), random_(settings.seed) {
+	opened_ = 0;
+	startedAt_ = 0;
+	lastReportAt_ = 0;
+	allConnectedAt_ = 0;
+
+	connectFailures_ = 0;
+	handshakes_ = 0;
+	disconnects_ = 0;
+	messagesSent_ = 0;
+	bytesSent_ = 0;
+	messagesReceived_ = 0;
+	bytesReceived_ = 0;
+	drops_ = 0;
+	moves_ = 0;
+	apiReplies_ = 0;
+	snapshotFrames_ = 0;
+
+	address_ = sockaddr_in();
+	address_.sin_family = AF_INET;
+	address_.sin_port = htons(static_cast<u_short>(settings_.port));
+	inet_pton(AF_INET, settings_.host.c_str(), &address_.sin_addr);
+
+	connections_.reserve(settings_.clients);
+	polls_.reserve(settings_.clients);
+}
+
+hgs::Swarm::~Swarm() {
+	for (auto& connection : connections_) {
+		if (connection.socket != INVALID_SOCKET) {
+			closesocket(connection.socket);
+		}
+	}
+}
+
+int64_t hgs::Swarm::Now() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int hgs::Swarm::Run() {
+	startedAt_ = Now();
+	lastReportAt_ = startedAt_;
+
+	const int64_t end = startedAt_ + static_cast<int64_t>(settings_.duration) * 1000000;
+	const int64_t connectInterval = settings_.connectRate > 0 ? 1000000 / settings_.connectRate : 0;
+	int64_t nextConnectAt = startedAt_;
+
+	while (true) {
+		int64_t now = Now();
+		if (now >= end) break;
+
+		// Ramp up connections at the configured rate
+		while (opened_ < settings_.clients && now >= nextConnectAt) {
+			Open(now);
+			nextConnectAt += connectInterval;
+		}
+
+		if (!polls_.empty()) {
+			const int ready = WSAPoll(polls_.data(), static_cast<ULONG>(polls_.size()), 1);
+			if (ready == SOCKET_ERROR) {
+				std::cerr << "WSAPoll failed, Err #" << WSAGetLastError() << std::endl;
+				return 1;
+			}
+
+			now = Now();
+			for (size_t i = 0; i < polls_.size() && ready > 0; i++) {
+				const short events = polls_[i].revents;
+				if (events == 0) continue;
+				polls_[i].revents = 0;
+
+				Connection& connection = connections_[i];
+				if (connection.phase == Phase::connecting) {
+					if (events & (POLLERR | POLLHUP | POLLNVAL)) {
+						connectFailures_++;
+						Close(connection, false);
+						continue;
+					}
+					if (events & POLLWRNORM) {
+						connection.phase = Phase::handshake;
+						connectLatency_.Add(now - connection.openedAt);
+						polls_[i].events = POLLRDNORM;
+					}
+					continue;
+				}
+				if (events & POLLRDNORM) {
+					OnReadable(connection, now);
+				}
+				if (connection.phase != Phase::closed && (events & POLLWRNORM)) {
+					OnWritable(connection);
+				}
+				if (connection.phase != Phase::closed && (events & (POLLERR | POLLHUP))) {
+					Close(connection, true);
+				}
+			}
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		now = Now();
+		for (auto& connection : connections_) {
+			if (connection.phase == Phase::active) {
+				Tick(connection, now);
+			}
+		}
+
+		if (settings_.reportInterval > 0 && now - lastReportAt_ >= static_cast<int64_t>(settings_.reportInterval) * 1000000) {
+			Report(now, false);
+			lastReportAt_ = now;
+		}
+	}
+
+	Report(Now(), true);
+	if (!settings_.jsonPath.empty()) {
+		WriteJson(Now());
+	}
+	return 0;
+}
+
+void hgs::Swarm::Open(const int64_t now) {
+	opened_++;
+
+	Connection connection;
+	connection.openedAt = now;
+	connection.socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	WSAPOLLFD poll = WSAPOLLFD();
+	poll.fd = connection.socket;
+	poll.events = POLLWRNORM;
+
+	if (connection.socket == INVALID_SOCKET) {
+		connectFailures_++;
+		connection.phase = Phase::closed;
+	} else {
+		u_long nonBlocking = 1;
+		ioctlsocket(connection.socket, FIONBIO, &nonBlocking);
+
+		const int result = connect(connection.socket, reinterpret_cast<const sockaddr*>(&address_), sizeof(address_));
+		if (result == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+			connectFailures_++;
+			closesocket(connection.socket);
+			connection.socket = INVALID_SOCKET;
+			connection.phase = Phase::closed;
+		}
+	}
+
+	poll.fd = connection.socket;
+	connections_.push_back(std::move(connection));
+	polls_.push_back(poll);
+}
+
+void hgs::Swarm::Close(Connection& connection, const bool dropped) {
+	if (connection.phase == Phase::closed) return;
+
+	if (dropped) {
+		disconnects_++;
+	}
+	closesocket(connection.socket);
+	connection.socket = INVALID_SOCKET;
+	connection.phase = Phase::closed;
+	connection.lastSeen.clear();
+
+	// A negative descriptor is ignored by WSAPoll
+	const size_t index = static_cast<size_t>(&connection - connections_.data());
+	polls_[index].fd = INVALID_SOCKET;
+	polls_[index].events = 0;
+}
+
+void hgs::Swarm::OnWritable(Connection& connection) {
+	Flush(connection);
+}
+
+void hgs::Swarm::OnReadable(Connection& connection, const int64_t now) {
+	char incoming[4096];
+
+	while (connection.phase != Phase::closed) {
+		const int bytes = recv(connection.socket, incoming, sizeof(incoming), 0);
+		if (bytes == 0) {
+			Close(connection, true);
+			return;
+		}
+		if (bytes < 0) {
+			if (WSAGetLastError() != WSAEWOULDBLOCK) {
+				Close(connection, true);
+			}
+			return;
+		}
+		bytesReceived_ += static_cast<uint64_t>(bytes);
+
+		// Every server payload is terminated by NUL
+		const char* cursor = incoming;
+		const char* end = incoming + bytes;
+		while (cursor < end) {
+			const char* terminator = static_cast<const char*>(memchr(cursor, '\0', static_cast<size_t>(end - cursor)));
+			if (terminator == nullptr) {
+				connection.inbox.append(cursor, end);
+				break;
+			}
+			connection.inbox.append(cursor, terminator);
+			OnPayload(connection, connection.inbox, now);
+			connection.inbox.clear();
+			cursor = terminator + 1;
+		}
+	}
+}
+
+void hgs::Swarm::OnPayload(Connection& connection, const std::string& payload, const int64_t now) {
+	if (connection.phase == Phase::handshake) {
+		// "Successfully connected to server|<id>|<seed>"
+		const size_t idAt = payload.find('|');
+		if (idAt == std::string::npos) {
+			Close(connection, true);
+			return;
+		}
+		connection.id = atoi(payload.c_str() + idAt + 1);
+		connection.phase = Phase::active;
+		handshakes_++;
+
+		if (handshakes_ == static_cast<uint64_t>(settings_.clients)) {
+			allConnectedAt_ = now;
+		}
+
+		// Spread the first sends over one interval
+		const int64_t interval = settings_.sendRate > 0.0 ? static_cast<int64_t>(1000000.0 / settings_.sendRate) : 0;
+		std::uniform_int_distribution<int64_t> offset(0, std::max<int64_t>(interval, 1));
+		connection.nextSendAt = now + offset(random_);
+
+		if (!settings_.lobbies.empty()) {
+			connection.lobby = static_cast<int>((handshakes_ - 1) % settings_.lobbies.size());
+			Queue(connection, "#join|" + settings_.lobbies[connection.lobby]);
+		}
+		if (settings_.moveInterval > 0.0) {
+			std::exponential_distribution<double> wait(1.0 / settings_.moveInterval);
+			connection.nextMoveAt = now + static_cast<int64_t>(wait(random_) * 1000000.0);
+		}
+		return;
+	}
+
+	// Walk the frames, "{sender|content}"
+	size_t at = 0;
+	// Frames of the join snapshot still to come
+	size_t catchUp = 0;
+	while ((at = payload.find('{', at)) != std::string::npos) {
+		const size_t separator = payload.find('|', at);
+		const size_t close = payload.find('}', at);
+		if (separator == std::string::npos || close == std::string::npos || separator > close) break;
+
+		const char* sender = payload.c_str() + at + 1;
+		const char* content = payload.c_str() + separator + 1;
+		const size_t length = close - separator - 1;
+
+		if (*sender == '#') {
+			apiReplies_++;
+		} else if (*sender == '0' && separator == at + 2) {
+			// Server frame, answer pings
+			if (length > 1 && content[0] == 'I') {
+				Queue(connection, "#pong|" + std::string(content + 1, length - 1));
+			}
+			// Snapshot of the joined lobby, "{0|C<frames>}"
+			else if (length > 1 && content[0] == 'C') {
+				catchUp = static_cast<size_t>(strtoul(content + 1, nullptr, 10));
+			}
+		} else if (*sender >= '1' && *sender <= '9') {
+			OnFrame(connection, atoi(sender), content, length, now, catchUp == 0);
+			if (catchUp > 0) catchUp--;
+		}
+		at = close + 1;
+	}
+}
+
+void hgs::Swarm::OnFrame(Connection& connection, const int sender, const char* data, const size_t length, const int64_t now, const bool live) {
+	// The sender left the lobby, it may come back later with a higher sequence
+	if (length == 1 && data[0] == 'D') {
+		connection.lastSeen.erase(sender);
+		return;
+	}
+
+	if (live) {
+		messagesReceived_++;
+	} else {
+		snapshotFrames_++;
+	}
+
+	// Swarm payloads are "L<sequence>,<sent at>,<padding>"
+	if (length < 4 || data[0] != 'L') return;
+
+	char* cursor = nullptr;
+	const uint32_t sequence = static_cast<uint32_t>(strtoul(data + 1, &cursor, 10));
+	if (cursor == nullptr || *cursor != ',') return;
+	const int64_t sentAt = strtoll(cursor + 1, nullptr, 10);
+
+	// Snapshot frames are old by design, they don't count as latency or gaps
+	if (live) {
+		broadcastLatency_.Add(now - sentAt);
+	}
+
+	auto seen = connection.lastSeen.find(sender);
+	if (seen != connection.lastSeen.end()) {
+		if (live && sequence > seen->second + 1) {
+			drops_ += sequence - seen->second - 1;
+		}
+		if (sequence > seen->second) {
+			seen->second = sequence;
+		}
+	} else {
+		connection.lastSeen.emplace(sender, sequence);
+	}
+}
+
+void hgs::Swarm::Tick(Connection& connection, const int64_t now) {
+	if (settings_.moveInterval > 0.0 && !settings_.lobbies.empty() && now >= connection.nextMoveAt) {
+		std::uniform_int_distribution<int> pick(0, static_cast<int>(settings_.lobbies.size()));
+		const int target = pick(random_) - 1;
+
+		if (target < 0 || target == connection.lobby) {
+			if (connection.lobby >= 0) {
+				Queue(connection, "#leave");
+				connection.lobby = -1;
+				moves_++;
+			}
+		} else {
+			Queue(connection, "#join|" + settings_.lobbies[target]);
+			connection.lobby = target;
+			moves_++;
+		}
+		// Peers will see a new sequence range from this client
+		connection.lastSeen.clear();
+
+		std::exponential_distribution<double> wait(1.0 / settings_.moveInterval);
+		connection.nextMoveAt = now + static_cast<int64_t>(wait(random_) * 1000000.0);
+	}
+
+	if (settings_.sendRate <= 0.0 || now < connection.nextSendAt) return;
+
+	const int64_t interval = static_cast<int64_t>(1000000.0 / settings_.sendRate);
+	connection.nextSendAt += interval;
+	// Don't try to catch up after a stall, that would only burst
+	if (connection.nextSendAt < now) {
+		connection.nextSendAt = now + interval;
+	}
+
+	std::string message = "L" + std::to_string(++connection.sequence) + "," + std::to_string(now) + ",";
+	if (static_cast<int>(message.size()) < settings_.payloadSize) {
+		message.append(static_cast<size_t>(settings_.payloadSize) - message.size(), 'x');
+	}
+	Queue(connection, message);
+	messagesSent_++;
+}
+
+void hgs::Swarm::Queue(Connection& connection, const std::string& message) {
+	connection.outbox.append(message);
+	connection.outbox.push_back('\0');
+	Flush(connection);
+}
+
+void hgs::Swarm::Flush(Connection& connection) {
+	const size_t index = static_cast<size_t>(&connection - connections_.data());
+
+	while (!connection.outbox.empty()) {
+		const int bytes = send(connection.socket, connection.outbox.data(), static_cast<int>(connection.outbox.size()), 0);
+		if (bytes == SOCKET_ERROR) {
+			if (WSAGetLastError() == WSAEWOULDBLOCK) {
+				// Continue when the socket is writable again
+				polls_[index].events = POLLRDNORM | POLLWRNORM;
+				return;
+			}
+			Close(connection, true);
+			return;
+		}
+		bytesSent_ += static_cast<uint64_t>(bytes);
+		connection.outbox.erase(0, static_cast<size_t>(bytes));
+	}
+	polls_[index].events = POLLRDNORM;
+}
+
+void hgs::Swarm::Report(const int64_t now, const bool final) {
+	const double elapsed = std::max(static_cast<double>(now - startedAt_) / 1000000.0, 0.001);
+
+	int active = 0;
+	for (auto& connection : connections_) {
+		if (connection.phase == Phase::active) active++;
+	}
+
+	std::cout << (final ? "\n===== Swarm report =====\n" : "") <<
+		"[" << static_cast<int>(elapsed) << "s] " <<
+		"active " << active << "/" << settings_.clients <<
+		" connect p50 " << connectLatency_.Percentile(0.50) / 1000.0 << "ms" <<
+		" | broadcast p50 " << broadcastLatency_.Percentile(0.50) / 1000.0 << "ms" <<
+		" p99 " << broadcastLatency_.Percentile(0.99) / 1000.0 << "ms" <<
+		" p999 " << broadcastLatency_.Percentile(0.999) / 1000.0 << "ms" <<
+		" | out " << static_cast<uint64_t>(messagesSent_ / elapsed) << " msg/s" <<
+		" in " << static_cast<uint64_t>(messagesReceived_ / elapsed) << " msg/s" <<
+		" | drops " << drops_ << " disconnects " << disconnects_ << std::endl;
+
+	if (final) {
+		const double rampSeconds = allConnectedAt_ > 0 ? static_cast<double>(allConnectedAt_ - startedAt_) / 1000000.0 : elapsed;
+		std::cout <<
+			"Connections: " << handshakes_ << " handshakes, " << connectFailures_ << " failed, " <<
+			static_cast<uint64_t>(handshakes_ / std::max(rampSeconds, 0.001)) << " connects/s\n" <<
+			"Connect latency: p50 " << connectLatency_.Percentile(0.50) / 1000.0 << "ms p99 " << connectLatency_.Percentile(0.99) / 1000.0 << "ms\n" <<
+			"Broadcast latency: samples " << broadcastLatency_.GetCount() <<
+			" mean " << broadcastLatency_.GetMean() / 1000.0 << "ms" <<
+			" p50 " << broadcastLatency_.Percentile(0.50) / 1000.0 << "ms" <<
+			" p99 " << broadcastLatency_.Percentile(0.99) / 1000.0 << "ms" <<
+			" p999 " << broadcastLatency_.Percentile(0.999) / 1000.0 << "ms" <<
+			" max " << broadcastLatency_.GetMax() / 1000.0 << "ms\n" <<
+			"Throughput: sent " << messagesSent_ << " msgs (" << bytesSent_ / elapsed / 1024.0 << " KiB/s), " <<
+			"received " << messagesReceived_ << " msgs (" << bytesReceived_ / elapsed / 1024.0 << " KiB/s)\n" <<
+			"Drops: " << drops_ << " messages, " << disconnects_ << " disconnects, " << moves_ << " lobby moves, " << apiReplies_ << " api replies, " << snapshotFrames_ << " snapshot frames\n" <<
+			"========================" << std::endl;
+	}
+}
+
+void hgs::Swarm::WriteJson(const int64_t now) const {
+	std::ofstream file(settings_.jsonPath, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Could not open " << settings_.jsonPath << std::endl;
+		return;
+	}
+
+	const double elapsed = std::max(static_cast<double>(now - startedAt_) / 1000000.0, 0.001);
+	const double rampSeconds = allConnectedAt_ > 0 ? static_cast<double>(allConnectedAt_ - startedAt_) / 1000000.0 : elapsed;
+
+	file << "{\n" <<
+		"  \"clients\": " << settings_.clients << ",\n" <<
+		"  \"send_rate\": " << settings_.sendRate << ",\n" <<
+		"  \"payload_size\": " << settings_.payloadSize << ",\n" <<
+		"  \"duration_s\": " << elapsed << ",\n" <<
+		"  \"handshakes\": " << handshakes_ << ",\n" <<
+		"  \"connect_failures\": " << connectFailures_ << ",\n" <<
+		"  \"connects_per_s\": " << handshakes_ / std::max(rampSeconds, 0.001) << ",\n" <<
+		"  \"connect_p50_us\": " << connectLatency_.Percentile(0.50) << ",\n" <<
+		"  \"connect_p99_us\": " << connectLatency_.Percentile(0.99) << ",\n" <<
+		"  \"broadcast_samples\": " << broadcastLatency_.GetCount() << ",\n" <<
+		"  \"broadcast_p50_us\": " << broadcastLatency_.Percentile(0.50) << ",\n" <<
+		"  \"broadcast_p99_us\": " << broadcastLatency_.Percentile(0.99) << ",\n" <<
+		"  \"broadcast_p999_us\": " << broadcastLatency_.Percentile(0.999) << ",\n" <<
+		"  \"broadcast_max_us\": " << broadcastLatency_.GetMax() << ",\n" <<
+		"  \"messages_sent\": " << messagesSent_ << ",\n" <<
+		"  \"messages_received\": " << messagesReceived_ << ",\n" <<
+		"  \"bytes_sent\": " << bytesSent_ << ",\n" <<
+		"  \"bytes_received\": " << bytesReceived_ << ",\n" <<
+		"  \"drops\": " << drops_ << ",\n" <<
+		"  \"disconnects\": " << disconnects_ << ",\n" <<
+		"  \"lobby_moves\": " << moves_ << "\n" <<
+		"}\n";
+}
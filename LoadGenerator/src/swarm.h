@@ -0,0 +1,158 @@
+#pragma once
+#include "pch.h"
+
+/**
+	Swarm.h
+	Purpose: Single threaded swarm of synthetic clients. Opens thousands of
+	non-blocking connections, speaks the welcome handshake and the {id|...}
+	protocol and measures how long broadcasts take to reach the peers
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+
+	struct SwarmSettings {
+		std::string host = "127.0.0.1";
+		int port = 15000;
+		// Total number of connections to open
+		int clients = 100;
+		// New connections per second
+		int connectRate = 200;
+		// Payloads per second sent by every client
+		double sendRate = 20.0;
+		// Payload size in bytes, including the timestamp prefix
+		int payloadSize = 64;
+		// Seconds to run after the first connection is opened
+		int duration = 30;
+		// Lobbies the clients spread over with #join, empty keeps everyone in main
+		std::vector<std::string> lobbies;
+		// Seconds between lobby moves per client, 0 disables moving
+		double moveInterval = 0.0;
+		// Seconds between progress lines
+		int reportInterval = 5;
+		// Optional path for the final report as JSON
+		std::string jsonPath;
+		unsigned int seed = 1;
+	};
+
+	/**
+		Log-linear histogram over microseconds with 64 sub buckets
+		per power of two, percentiles are accurate to ~1.5%
+	 */
+	class LatencyRecorder {
+	public:
+		LatencyRecorder();
+		void Add(int64_t microseconds);
+		int64_t Percentile(double percentile) const;
+		uint64_t GetCount() const { return count_; };
+		int64_t GetMax() const { return max_; };
+		double GetMean() const { return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_); };
+	private:
+		static constexpr int subBits = 6;
+		static constexpr int subBuckets = 1 << subBits;
+
+		static size_t Index(int64_t value);
+		static int64_t UpperBound(size_t index);
+
+		std::vector<uint64_t> buckets_;
+		uint64_t count_;
+		int64_t max_;
+		double sum_;
+	};
+
+	class Swarm {
+	public:
+		Swarm(const SwarmSettings& settings);
+		~Swarm();
+		/**
+			Run the swarm for the configured duration
+			and print the final report
+
+			@return int 0 on success
+		 */
+		int Run();
+	private:
+		enum class Phase {
+			connecting,
+			handshake,
+			active,
+			closed
+		};
+
+		struct Connection {
+			SOCKET socket = INVALID_SOCKET;
+			Phase phase = Phase::connecting;
+			int id = 0;
+			// Index of the lobby the client is in, -1 for main
+			int lobby = -1;
+			uint32_t sequence = 0;
+			int64_t openedAt = 0;
+			int64_t nextSendAt = 0;
+			int64_t nextMoveAt = 0;
+			// Bytes received but not yet terminated by NUL
+			std::string inbox;
+			// Bytes accepted by the swarm but not yet by the socket
+			std::string outbox;
+			// Last sequence seen from each sender, used to count drops
+			std::unordered_map<int, uint32_t> lastSeen;
+		};
+
+		void Open(int64_t now);
+		void Close(Connection& connection, bool dropped);
+		void OnWritable(Connection& connection);
+		void OnReadable(Connection& connection, int64_t now);
+		/**
+			Handle one NUL terminated server payload,
+			the welcome message or a set of frames
+
+			@return void
+		 */
+		void OnPayload(Connection& connection, const std::string& payload, int64_t now);
+		/**
+			Handle one frame of another client
+
+			@param live False for frames of the join snapshot, they
+			only set where the sender's sequence continues
+			@return void
+		 */
+		void OnFrame(Connection& connection, int sender, const char* data, size_t length, int64_t now, bool live);
+		void Tick(Connection& connection, int64_t now);
+		void Queue(Connection& connection, const std::string& message);
+		void Flush(Connection& connection);
+		void Report(int64_t now, bool final);
+		void WriteJson(int64_t now) const;
+
+		static int64_t Now();
+
+		SwarmSettings settings_;
+		sockaddr_in address_;
+		std::default_random_engine random_;
+
+		std::vector<Connection> connections_;
+		std::vector<WSAPOLLFD> polls_;
+		int opened_;
+
+		int64_t startedAt_;
+		int64_t lastReportAt_;
+		int64_t allConnectedAt_;
+
+		// Counters
+		uint64_t connectFailures_;
+		uint64_t handshakes_;
+		uint64_t disconnects_;
+		uint64_t messagesSent_;
+		uint64_t bytesSent_;
+		uint64_t messagesReceived_;
+		uint64_t bytesReceived_;
+		uint64_t drops_;
+		uint64_t moves_;
+		uint64_t apiReplies_;
+		uint64_t snapshotFrames_;
+
+		LatencyRecorder connectLatency_;
+		LatencyRecorder broadcastLatency_;
+	};
+
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "simulation.h"
+
+using namespace hgs;
+
+/**
+	main.cpp
+	Purpose: Simulation entry point. Runs a lobby of simulated clients
+	in-process on a virtual clock and reports throughput and latency
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace {
+	void PrintUsage() {
+		std::cout <<
+			"Usage: Simulation [options]\n\n\
+   --clients <n>           Simulated clients in the lobby (default 100)\n\
+   --size <bytes>          Payload size, below 1024 (default 64)\n\
+   --duration <s>          Simulated seconds to run (default 60)\n\
+   --clock-speed <ms>      Lobby sleep between phases (default 50)\n\
+   --timeout-tries <n>     Polls before non responding clients are dropped (default 30)\n\
+   --timeout-delay <ms>    Time between polls (default 0.5)\n\
+   --ping-interval <ms>    Ping interval, 0 disables (default 0)\n\
+   --sample-rate <n>       Stamp every n:th message, 0 disables (default 0)\n\
+   --think <us>            Time a client takes to answer the server (default 0)\n\
+   --think-jitter <us>     Extra random answer time, up to the value (default 0)\n\
+   --latency <ms>          One way link delay in each direction (default 0)\n\
+   --jitter <ms>           Extra random link delay, up to the value (default 0)\n\
+   --bandwidth <kbit/s>    Link rate in each direction, 0 is unlimited (default 0)\n\
+   --reorder <percent>     Messages held back so later ones overtake them (default 0)\n\
+   --stall-chance <percent> Chance per message that the link stalls (default 0)\n\
+   --stall-duration <ms>   Length of a stall (default 0)\n\
+   --delta                 Clients ask for delta encoded frames with #delta\n\
+   --keyframe-interval <n> Payloads between complete keyframes with --delta (default 60)\n\
+   --compress              Clients ask for compressed frames with #compress\n\
+   --threshold <bytes>     Smallest frame block that is compressed (default 256)\n\
+   --dictionary <file>     Compression dictionary, see /Compression train\n\
+   --channels <n>          Clients subscribe to one of n channels and only talk there (default 0)\n\
+   --interest <radius>     Clients wander and report positions, frames only reach clients within the radius (default 0)\n\
+   --world <size>          Width of the square world with --interest (default 1000)\n\
+   --direct <percent>      Payloads addressed to one random client instead of the lobby (default 0)\n\
+   --json <file>           Write the final report as JSON\n\
+   --seed <n>              Seed for the think time jitter and the links (default 1)\n\
+   --verbose               Keep the engine's info logging\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	sim::SimulationSettings settings;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string option = argv[i];
+		if (option == "--help" || option == "-h") {
+			PrintUsage();
+			return 0;
+		}
+		if (option == "--verbose") {
+			settings.verbose = true;
+			continue;
+		}
+		if (option == "--delta") {
+			settings.delta = true;
+			continue;
+		}
+		if (option == "--compress") {
+			settings.compress = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << option << std::endl;
+			PrintUsage();
+			return 1;
+		}
+
+		const std::string value = argv[++i];
+		try {
+			if (option == "--clients") settings.clients = std::stoi(value);
+			else if (option == "--size") settings.payloadSize = std::stoi(value);
+			else if (option == "--duration") settings.duration = std::stod(value);
+			else if (option == "--clock-speed") settings.clockSpeed = std::stoi(value);
+			else if (option == "--timeout-tries") settings.timeoutTries = std::stoi(value);
+			else if (option == "--timeout-delay") settings.timeoutDelay = std::stof(value);
+			else if (option == "--ping-interval") settings.pingInterval = std::stoi(value);
+			else if (option == "--sample-rate") settings.latencySampleRate = std::stoi(value);
+			else if (option == "--think") settings.thinkTime = std::stoi(value);
+			else if (option == "--think-jitter") settings.thinkJitter = std::stoi(value);
+			else if (option == "--latency") settings.impairment.latency = std::stoll(value) * 1000;
+			else if (option == "--jitter") settings.impairment.jitter = std::stoll(value) * 1000;
+			else if (option == "--bandwidth") settings.impairment.bandwidth = std::stoll(value) * 1000 / 8;
+			else if (option == "--reorder") settings.impairment.reorder = std::stod(value) / 100.0;
+			else if (option == "--stall-chance") settings.impairment.stallChance = std::stod(value) / 100.0;
+			else if (option == "--stall-duration") settings.impairment.stallDuration = std::stoll(value) * 1000;
+			else if (option == "--keyframe-interval") settings.keyframeInterval = std::stoi(value);
+			else if (option == "--threshold") settings.compressionThreshold = std::stoi(value);
+			else if (option == "--dictionary") settings.dictionaryPath = value;
+			else if (option == "--channels") settings.channels = std::stoi(value);
+			else if (option == "--interest") settings.interestRadius = std::stof(value);
+			else if (option == "--world") settings.worldSize = std::stof(value);
+			else if (option == "--direct") settings.direct = std::stod(value) / 100.0;
+			else if (option == "--json") settings.jsonPath = value;
+			else if (option == "--seed") settings.seed = static_cast<unsigned int>(std::stoul(value));
+			else {
+				std::cerr << "Unknown option " << option << std::endl;
+				PrintUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			std::cerr << "Bad value for " << option << ": " << value << std::endl;
+			return 1;
+		}
+	}
+
+	if (settings.clients <= 0 || settings.payloadSize <= 0 || settings.payloadSize >= 1024 || settings.clockSpeed < 0) {
+		std::cerr << "Clients and size have to be positive and size below 1024" << std::endl;
+		return 1;
+	}
+
+	sim::Simulation simulation(settings);
+	return simulation.Run();
+}
@@ -0,0 +1,417 @@
+#include "pch.h"
+#include "simulation.h"
+#include "lobby.h"
+#include "client.h"
+
+namespace {
+	// Handles of simulated connections, far above anything the socket set holds
+	constexpr SOCKET firstHandle = SOCKET(1) << 24;
+}
+
+void hgs::sim::VirtualClock::Sleep(const std::chrono::microseconds duration) {
+	const int64_t wakeAt = now_ + duration.count();
+
+	while (!events_.empty() && events_.top().at <= wakeAt) {
+		Event event = events_.top();
+		events_.pop();
+		now_ = std::max(now_, event.at);
+		event.run();
+	}
+	now_ = wakeAt;
+
+	if (idle_) {
+		idle_();
+	}
+}
+
+void hgs::sim::VirtualClock::Schedule(const int64_t at, std::function<void()> event) {
+	events_.push({ at, order_++, std::move(event) });
+}
+
+void hgs::sim::VirtualClock::SetIdle(std::function<void()> idle) { idle_ = std::move(idle); }
+
+hgs::sim::MemoryTransport::MemoryTransport(std::shared_ptr<Pipe> pipe, const SOCKET handle) : pipe_(std::move(pipe)), handle_(handle) {
+}
+
+int hgs::sim::MemoryTransport::Receive(char* buffer, const int length) {
+	if (pipe_->toServer.empty()) {
+		// Closed and drained, same as a lost connection
+		return 0;
+	}
+	const std::string& message = pipe_->toServer.front();
+	const int bytes = std::min(static_cast<int>(message.size()), length - 1);
+	memcpy(buffer, message.data(), static_cast<size_t>(bytes));
+	buffer[bytes] = '\0';
+	pipe_->toServer.pop_front();
+	return bytes + 1;
+}
+
+int hgs::sim::MemoryTransport::Send(const char* data, const int length) {
+	if (pipe_->closed) return -1;
+	// Payloads are sent with their terminator
+	pipe_->toPeer.emplace_back(data, static_cast<size_t>(std::max(length - 1, 0)));
+	return length;
+}
+
+hgs::sim::LatencyCounter::LatencyCounter() : buckets_(bucketCount, 0), count_(0), max_(0), sum_(0.0) {
+}
+
+void hgs::sim::LatencyCounter::Add(int64_t microseconds) {
+	microseconds = std::max<int64_t>(microseconds, 0);
+	const size_t index = std::min(static_cast<size_t>(microseconds / bucketWidth), bucketCount - 1);
+	buckets_[index]++;
+	count_++;
+	max_ = std::max(max_, microseconds);
+	sum_ += static_cast<double>(microseconds);
+}
+
+int64_t hgs::sim::LatencyCounter::Percentile(const double percentile) const {
+	if (count_ == 0) return 0;
+
+	const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_))));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets_.size(); i++) {
+		seen += buckets_[i];
+		if (seen >= target) {
+			return std::min(static_cast<int64_t>(i + 1) * bucketWidth, max_);
+		}
+	}
+	return max_;
+}
+
+hgs::sim::Simulation::Simulation(const SimulationSettings& settings) : settings_(settings), random_(settings.seed) {
+	ticks_ = 0;
+	messagesSent_ = 0;
+	bytesSent_ = 0;
+	framesDelivered_ = 0;
+	bytesDelivered_ = 0;
+	egressBytes_ = 0;
+	decodeErrors_ = 0;
+	pongs_ = 0;
+	drops_ = 0;
+
+	const Impairment& impairment = settings_.impairment;
+	impaired_ = impairment.latency > 0 || impairment.jitter > 0 || impairment.bandwidth > 0 ||
+		impairment.reorder > 0.0 || impairment.stallChance > 0.0;
+
+	conf_.serverPort = 0;
+	conf_.clockSpeed = settings_.clockSpeed;
+	conf_.timeoutTries = settings_.timeoutTries;
+	conf_.timeoutDelay = settings_.timeoutDelay;
+	conf_.maxConnections = 0;
+	conf_.rconEnable = false;
+	conf_.logPath = "logs/";
+	conf_.sessionPath = "sessions/";
+	conf_.lobbyMaxConnections = 0;
+	conf_.lobbySessionLogging = false;
+	conf_.lobbyStartIdAt = 1;
+	conf_.clientStartIdAt = 1;
+	conf_.latencySampleRate = settings_.latencySampleRate;
+	conf_.pingInterval = settings_.pingInterval;
+	conf_.pingTimeout = 3000;
+	conf_.lobbyAdaptiveTimeout = false;
+	conf_.lobbyMaxChannels = std::max(settings_.channels, 64);
+	conf_.interestCellSize = settings_.interestRadius > 0.0f ? settings_.interestRadius : 100.0f;
+	conf_.interestRadius = settings_.interestRadius;
+	conf_.snapshotEnable = true;
+	conf_.snapshotTicks = 10;
+	conf_.deltaEnable = settings_.delta;
+	conf_.deltaKeyframeInterval = settings_.keyframeInterval;
+	conf_.compressionEnable = settings_.compress;
+	conf_.compressionThreshold = settings_.compressionThreshold;
+	conf_.compressionDictionary = settings_.dictionaryPath;
+
+	// The clock has to be in place before the lobby and clients read it
+	memory_ = new SharedMemory(conf_);
+	memory_->SetClock(&clock_);
+	lobby_ = memory_->AddLobby("main", false);
+
+	peers_.resize(static_cast<size_t>(settings_.clients));
+	for (size_t i = 0; i < peers_.size(); i++) {
+		Connect(i);
+	}
+
+	if (!settings_.verbose) {
+		spdlog::set_level(spdlog::level::warn);
+	}
+
+	clock_.SetIdle([this]() { StepClients(); });
+}
+
+hgs::sim::Simulation::~Simulation() {
+	lobby_->CleanUp();
+	for (auto& peer : peers_) {
+		delete peer.client;
+		peer.client = nullptr;
+	}
+	delete memory_;
+	delete lobby_;
+}
+
+void hgs::sim::Simulation::Connect(const size_t index) {
+	Peer& peer = peers_[index];
+	peer.id = static_cast<int>(index) + conf_.clientStartIdAt;
+	peer.pipe = std::make_shared<Pipe>();
+	if (settings_.interestRadius > 0.0f) {
+		std::uniform_real_distribution<float> place(0.0f, settings_.worldSize);
+		peer.position.x = place(random_);
+		peer.position.y = place(random_);
+	}
+
+	const SOCKET handle = firstHandle + static_cast<SOCKET>(index);
+	memory_->AddSocket(handle);
+
+	std::unique_ptr<Transport> transport = std::make_unique<MemoryTransport>(peer.pipe, handle);
+	if (impaired_) {
+		// Same derivation as the server, seed plus client id
+		transport = std::make_unique<ImpairedTransport>(std::move(transport), settings_.impairment, &clock_, settings_.seed + static_cast<unsigned int>(peer.id));
+	}
+	peer.client = new Client(std::move(transport), memory_, peer.id, lobby_->GetId());
+	lobby_->AddClient(peer.client, false);
+
+	// The peer knows its id already, it starts talking right away
+	Answer(index);
+}
+
+void hgs::sim::Simulation::StepClients() {
+	for (auto& peer : peers_) {
+		Client* client = peer.client;
+		if (client == nullptr) continue;
+
+		// Same life cycle as Client::Loop, without a thread per client
+		if (client->IsOnline()) {
+			client->Step();
+		} else if (client->IsAttached()) {
+			if (!peer.dropRequested) {
+				client->RequestDrop();
+				peer.dropRequested = true;
+			}
+		} else {
+			delete client;
+			peer.client = nullptr;
+			drops_++;
+			continue;
+		}
+
+		while (!peer.pipe->toPeer.empty()) {
+			const std::string payload = std::move(peer.pipe->toPeer.front());
+			peer.pipe->toPeer.pop_front();
+			OnPayload(peer, payload);
+		}
+	}
+}
+
+void hgs::sim::Simulation::OnPayload(Peer& peer, const std::string& received) {
+	const int64_t now = clock_.Now();
+	egressBytes_ += received.size() + 1;
+
+	// Compressed frames follow the plain ones
+	std::string payload = received;
+	const size_t marker = received.find(compressedMarker);
+	if (marker != std::string::npos) {
+		std::string frames;
+		if (!memory_->GetCompressor().Decompress(received.data() + marker + 1, received.size() - marker - 1, frames)) {
+			decodeErrors_++;
+		}
+		payload.resize(marker);
+		payload.append(frames);
+	}
+
+	// Frames are "{sender|body}" back to back
+	std::string body;
+	std::string decoded;
+	size_t at = 0;
+	while ((at = payload.find('{', at)) != std::string::npos) {
+		const size_t bar = payload.find('|', at);
+		const size_t close = payload.find('}', at);
+		if (bar == std::string::npos || close == std::string::npos || bar > close) break;
+
+		const char kind = payload[at + 1];
+		const int sender = std::atoi(payload.c_str() + at + 1);
+		body.assign(payload, bar + 1, close - bar - 1);
+		at = close + 1;
+
+		// Server frames, only pings need an answer
+		if (kind == '0') {
+			if (body[0] == 'I') {
+				peer.ping = static_cast<uint32_t>(std::strtoul(body.c_str() + 1, nullptr, 10));
+			}
+			continue;
+		}
+		if (kind == '*') {
+			peer.decoder.Reset();
+			continue;
+		}
+		// Compressed frames hold the peer's own frame as well
+		if (kind == '#' || sender == peer.id) continue;
+
+		// Rebuilds delta frames and drops the latency header of sampled frames
+		if (!peer.decoder.Decode(sender, body, decoded)) {
+			decodeErrors_++;
+			continue;
+		}
+		// Position, channel and addressed frames keep their headers
+		size_t start = 0;
+		while (decoded.compare(start, 3, positionHeader) == 0 || decoded.compare(start, 3, channelHeader) == 0 ||
+			decoded.compare(start, 3, targetHeader) == 0) {
+			const size_t end = decoded.find('@', start + 3);
+			if (end == std::string::npos) break;
+			start = end + 1;
+		}
+		if (start >= decoded.size() || decoded[start] != 'L') continue;
+
+		char* end = nullptr;
+		std::strtoul(decoded.c_str() + start + 1, &end, 10);
+		if (*end != ',') continue;
+		const int64_t sentAt = std::strtoll(end + 1, nullptr, 10);
+
+		latency_.Add(now - sentAt);
+		framesDelivered_++;
+		bytesDelivered_ += decoded.size();
+	}
+
+	// Every server payload is answered, like a lock-step client
+	Answer(static_cast<size_t>(&peer - peers_.data()));
+}
+
+void hgs::sim::Simulation::Answer(const size_t index) {
+	Peer& peer = peers_[index];
+	if (peer.answering) return;
+	peer.answering = true;
+
+	int64_t delay = settings_.thinkTime;
+	if (settings_.thinkJitter > 0) {
+		delay += std::uniform_int_distribution<int64_t>(0, settings_.thinkJitter)(random_);
+	}
+
+	clock_.Schedule(clock_.Now() + delay, [this, index]() {
+		Peer& peer = peers_[index];
+		peer.answering = false;
+		if (peer.client == nullptr || peer.pipe->closed) return;
+
+		std::string message;
+		if (settings_.delta && !peer.deltaRequested) {
+			message = "#delta|on";
+			peer.deltaRequested = true;
+		} else if (settings_.channels > 0 && !peer.subscribed) {
+			message = "#sub|c" + std::to_string(peer.id % settings_.channels);
+			peer.subscribed = true;
+		} else if (settings_.compress && !peer.compressRequested) {
+			message = "#compress|" + std::to_string(memory_->GetCompressor().GetId());
+			peer.compressRequested = true;
+		} else if (peer.ping != 0) {
+			message = "#pong|" + std::to_string(peer.ping);
+			peer.ping = 0;
+			pongs_++;
+		} else {
+			// Sequence and timestamp change every tick, the padding field never does
+			if (settings_.interestRadius > 0.0f) {
+				// A short random walk, kept inside the world
+				std::uniform_real_distribution<float> step(-5.0f, 5.0f);
+				peer.position.x = std::min(std::max(peer.position.x + step(random_), 0.0f), settings_.worldSize);
+				peer.position.y = std::min(std::max(peer.position.y + step(random_), 0.0f), settings_.worldSize);
+
+				char header[64];
+				snprintf(header, sizeof(header), "%s%.1f,%.1f@", positionHeader, peer.position.x, peer.position.y);
+				message = header;
+			}
+			if (settings_.channels > 0) {
+				message += std::string(channelHeader) + "c" + std::to_string(peer.id % settings_.channels) + "@";
+			}
+			if (settings_.direct > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < settings_.direct) {
+				const size_t target = std::uniform_int_distribution<size_t>(0, peers_.size() - 1)(random_);
+				message += std::string(targetHeader) + std::to_string(peers_[target].id) + "@";
+			}
+			message += "L" + std::to_string(++peer.sequence) + "," + std::to_string(clock_.Now()) + ",|";
+			if (static_cast<int>(message.size()) < settings_.payloadSize) {
+				message.append(static_cast<size_t>(settings_.payloadSize) - message.size(), 'x');
+			}
+		}
+		bytesSent_ += message.size();
+		messagesSent_++;
+		peer.pipe->toServer.push_back(std::move(message));
+	});
+}
+
+int hgs::sim::Simulation::Run() {
+	const int64_t endAt = static_cast<int64_t>(settings_.duration * 1000000.0);
+	const auto wallStart = std::chrono::steady_clock::now();
+
+	// Same cadence as Lobby::Execute, without the pause handshake
+	while (clock_.Now() < endAt) {
+		lobby_->Loop();
+		ticks_++;
+		clock_.Sleep(std::chrono::milliseconds(conf_.clockSpeed));
+	}
+
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	Report(wall);
+	if (!settings_.jsonPath.empty()) {
+		WriteJson(wall);
+	}
+	return 0;
+}
+
+void hgs::sim::Simulation::Report(const double wall_seconds) const {
+	const double simulated = static_cast<double>(clock_.Now()) / 1000000.0;
+	const double perSecond = simulated > 0.0 ? 1.0 / simulated : 0.0;
+
+	printf("\n======= Simulation ========\n");
+	printf("clients            %d (%llu dropped)\n", settings_.clients, static_cast<unsigned long long>(drops_));
+	printf("link               %s\n", impaired_ ? settings_.impairment.ToString().c_str() : "unimpaired");
+	if (settings_.interestRadius > 0.0f) {
+		printf("interest           radius %.0f in a %.0f wide world\n", settings_.interestRadius, settings_.worldSize);
+	}
+	printf("simulated          %.1f s, %llu ticks\n", simulated, static_cast<unsigned long long>(ticks_));
+	printf("sent               %llu messages, %llu bytes, %llu pongs\n",
+		static_cast<unsigned long long>(messagesSent_), static_cast<unsigned long long>(bytesSent_), static_cast<unsigned long long>(pongs_));
+	printf("delivered          %llu frames (%.0f/s), %.2f MB/s\n",
+		static_cast<unsigned long long>(framesDelivered_), static_cast<double>(framesDelivered_) * perSecond,
+		static_cast<double>(bytesDelivered_) * perSecond / 1e6);
+	printf("egress             %llu bytes (%.2f MB/s)%s\n", static_cast<unsigned long long>(egressBytes_),
+		static_cast<double>(egressBytes_) * perSecond / 1e6, settings_.delta ? ", delta encoded" : (settings_.compress ? ", compressed" : ""));
+	if (decodeErrors_ > 0) {
+		printf("decode errors      %llu\n", static_cast<unsigned long long>(decodeErrors_));
+	}
+	printf("latency us         mean %.0f p50 %lld p99 %lld p999 %lld max %lld\n", latency_.GetMean(),
+		static_cast<long long>(latency_.Percentile(50.0)), static_cast<long long>(latency_.Percentile(99.0)),
+		static_cast<long long>(latency_.Percentile(99.9)), static_cast<long long>(latency_.GetMax()));
+	printf("---------------------------\n");
+	printf("wall time          %.2f s, %.0f ticks/s, %.0fx real time\n", wall_seconds,
+		wall_seconds > 0.0 ? static_cast<double>(ticks_) / wall_seconds : 0.0,
+		wall_seconds > 0.0 ? simulated / wall_seconds : 0.0);
+	printf("===========================\n");
+
+	if (settings_.latencySampleRate > 0) {
+		std::cout << memory_->GetLatency().List() << std::endl;
+	}
+}
+
+void hgs::sim::Simulation::WriteJson(const double wall_seconds) const {
+	std::ofstream file(settings_.jsonPath, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Could not write " << settings_.jsonPath << std::endl;
+		return;
+	}
+
+	char buffer[1024];
+	snprintf(buffer, sizeof(buffer),
+		"{\n"
+		"  \"clients\": %d,\n  \"payload_size\": %d,\n  \"seed\": %u,\n"
+		"  \"simulated_seconds\": %.3f,\n  \"ticks\": %llu,\n  \"dropped\": %llu,\n"
+		"  \"messages_sent\": %llu,\n  \"bytes_sent\": %llu,\n  \"pongs\": %llu,\n"
+		"  \"frames_delivered\": %llu,\n  \"bytes_delivered\": %llu,\n"
+		"  \"egress_bytes\": %llu,\n  \"delta\": %s,\n  \"compressed\": %s,\n  \"decode_errors\": %llu,\n"
+		"  \"latency_us\": {\"mean\": %.1f, \"p50\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld},\n"
+		"  \"wall_seconds\": %.3f\n"
+		"}\n",
+		settings_.clients, settings_.payloadSize, settings_.seed,
+		static_cast<double>(clock_.Now()) / 1000000.0, static_cast<unsigned long long>(ticks_), static_cast<unsigned long long>(drops_),
+		static_cast<unsigned long long>(messagesSent_), static_cast<unsigned long long>(bytesSent_), static_cast<unsigned long long>(pongs_),
+		static_cast<unsigned long long>(framesDelivered_), static_cast<unsigned long long>(bytesDelivered_),
+		static_cast<unsigned long long>(egressBytes_), settings_.delta ? "true" : "false", settings_.compress ? "true" : "false", static_cast<unsigned long long>(decodeErrors_),
+		latency_.GetMean(), static_cast<long long>(latency_.Percentile(50.0)), static_cast<long long>(latency_.Percentile(99.0)),
+		static_cast<long long>(latency_.Percentile(99.9)), static_cast<long long>(latency_.GetMax()),
+		wall_seconds);
+	file << buffer;
+}
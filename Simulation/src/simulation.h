@@ -0,0 +1,223 @@
+#pragma once
+#include "pch.h"
+#include "clock.h"
+#include "transport.h"
+#include "shared_memory.h"
+#include "impaired_transport.h"
+#include "delta.h"
+#include "interest.h"
+
+/**
+	Simulation.h
+	Purpose: Deterministic in-process simulation of a lobby. The engine runs
+	on a virtual clock against simulated clients connected through memory
+	pipes, so hours of ticks pass in seconds and every run with the same
+	settings gives the same numbers
+
+	@author Hampus Hallkvist
+	@version 0.4 19/10/2026
+*/
+
+namespace hgs {
+	namespace sim {
+
+		struct SimulationSettings {
+			// Number of simulated clients in the lobby
+			int clients = 100;
+			// Payload size in bytes, including the timestamp prefix
+			int payloadSize = 64;
+			// Simulated seconds to run
+			double duration = 60.0;
+			// Engine settings, same meaning as in server.conf
+			int clockSpeed = 50;
+			int timeoutTries = 30;
+			float timeoutDelay = 0.5f;
+			int pingInterval = 0;
+			int latencySampleRate = 0;
+			// Microseconds a client waits before answering the server, plus up to thinkJitter more
+			int thinkTime = 0;
+			int thinkJitter = 0;
+			// Link conditions between every client and the server
+			Impairment impairment;
+			// Clients ask for delta encoded frames, keyframes as delta.keyframe_interval
+			bool delta = false;
+			int keyframeInterval = 60;
+			// Clients ask for the lobby's compressed frames
+			bool compress = false;
+			int compressionThreshold = 256;
+			std::string dictionaryPath;
+			// Every client subscribes to channel id % channels and tags its frames with it, 0 broadcasts
+			int channels = 0;
+			// Clients wander a square world and report positions, only frames within the radius arrive, 0 broadcasts
+			float interestRadius = 0.0f;
+			float worldSize = 1000.0f;
+			// Share of payloads addressed to one random client instead of the whole lobby
+			double direct = 0.0;
+			// Optional path for the final report as JSON
+			std::string jsonPath;
+			bool verbose = false;
+			unsigned int seed = 1;
+		};
+
+		/**
+			Discrete event clock. Sleeping runs every event due
+			before the wake up time, in time order and then in
+			the order they were scheduled, and then calls the
+			idle callback once
+		 */
+		class VirtualClock : public Clock {
+		public:
+			int64_t Now() const override { return now_; };
+			void Sleep(std::chrono::microseconds duration) override;
+			/**
+				Run an event at a point in virtual time
+
+				@param at Microseconds, events in the past run on the next sleep
+				@param event The work to do
+				@return void
+			 */
+			void Schedule(int64_t at, std::function<void()> event);
+			void SetIdle(std::function<void()> idle);
+		private:
+			struct Event {
+				int64_t at;
+				uint64_t order;
+				std::function<void()> run;
+			};
+			struct Later {
+				bool operator()(const Event& left, const Event& right) const {
+					return left.at != right.at ? left.at > right.at : left.order > right.order;
+				}
+			};
+
+			std::priority_queue<Event, std::vector<Event>, Later> events_;
+			std::function<void()> idle_;
+			int64_t now_ = 0;
+			uint64_t order_ = 0;
+		};
+
+		// Messages in flight between a client object and its simulated peer
+		struct Pipe {
+			std::deque<std::string> toServer;
+			std::deque<std::string> toPeer;
+			bool closed = false;
+		};
+
+		/**
+			Server side end of a pipe. Every Receive returns
+			one message, like one recv of a lock-step client
+		 */
+		class MemoryTransport : public Transport {
+		public:
+			MemoryTransport(std::shared_ptr<Pipe> pipe, SOCKET handle);
+
+			int Receive(char* buffer, int length) override;
+			int Send(const char* data, int length) override;
+			bool Ready() override { return pipe_->closed || !pipe_->toServer.empty(); };
+			void Close() override { pipe_->closed = true; };
+			SOCKET GetHandle() const override { return handle_; };
+		private:
+			std::shared_ptr<Pipe> pipe_;
+			const SOCKET handle_;
+		};
+
+		/**
+			Fixed width histogram over microseconds,
+			exact enough for virtual time which only
+			moves in poll sized steps
+		 */
+		class LatencyCounter {
+		public:
+			static constexpr int64_t bucketWidth = 100;
+			static constexpr size_t bucketCount = 100000;
+
+			LatencyCounter();
+			void Add(int64_t microseconds);
+			int64_t Percentile(double percentile) const;
+			uint64_t GetCount() const { return count_; };
+			int64_t GetMax() const { return max_; };
+			double GetMean() const { return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_); };
+		private:
+			std::vector<uint64_t> buckets_;
+			uint64_t count_;
+			int64_t max_;
+			double sum_;
+		};
+
+		class Simulation {
+		public:
+			Simulation(const SimulationSettings& settings);
+			~Simulation();
+			/**
+				Run the lobby for the configured simulated
+				duration and print the report
+
+				@return int 0 on success
+			 */
+			int Run();
+		private:
+			struct Peer {
+				int id = 0;
+				std::shared_ptr<Pipe> pipe;
+				// Server side object, nullptr once the lobby dropped it
+				Client* client = nullptr;
+				bool dropRequested = false;
+				// An answer is scheduled but not yet sent
+				bool answering = false;
+				uint32_t sequence = 0;
+				// Sequence of the last unanswered ping, 0 for none
+				uint32_t ping = 0;
+				bool deltaRequested = false;
+				bool compressRequested = false;
+				bool subscribed = false;
+				Position position;
+				DeltaDecoder decoder;
+			};
+
+			void Connect(size_t index);
+			/**
+				Idle callback of the clock, advances every client
+				object one loop iteration and lets the peers read
+				what the server sent
+
+				@return void
+			 */
+			void StepClients();
+			void OnPayload(Peer& peer, const std::string& received);
+			/**
+				Schedule the peer's next message after its think
+				time, a pong if a ping is waiting and a game
+				payload otherwise
+
+				@return void
+			 */
+			void Answer(size_t index);
+			void Report(double wall_seconds) const;
+			void WriteJson(double wall_seconds) const;
+
+			SimulationSettings settings_;
+			Configuration conf_;
+			VirtualClock clock_;
+			SharedMemory* memory_;
+			Lobby* lobby_;
+			std::vector<Peer> peers_;
+			default_random_engine random_;
+			bool impaired_;
+
+			// Counters
+			uint64_t ticks_;
+			uint64_t messagesSent_;
+			uint64_t bytesSent_;
+			uint64_t framesDelivered_;
+			uint64_t bytesDelivered_;
+			// Server payload bytes as sent, after delta encoding
+			uint64_t egressBytes_;
+			uint64_t decodeErrors_;
+			uint64_t pongs_;
+			uint64_t drops_;
+
+			LatencyCounter latency_;
+		};
+
+	}
+}
@@ -90,6 +90,13 @@ int symbiosis::Client::Send(std::string& outgoing) {
 	return 0;
 }
 
+int symbiosis::Client::SendAt(const float x, const float y, const std::string& payload) {
+	std::string outgoing;
+	hgs::PositionSchema::Encode(outgoing, hgs::PositionSchema::Tuple{ x, y });
+	outgoing.append(payload);
+	return Send(outgoing);
+}
+
 std::string symbiosis::Client::Receive() {
 	if (connectionEstablished_) {
 		char incoming[1024];
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <WS2tcpip.h>
 #include <regex>
+#include "../../GameServer/src/schema.h"
 #pragma comment(lib, "ws2_32.lib")
 
 namespace symbiosis {
@@ -11,6 +12,8 @@ namespace symbiosis {
 		Client(std::string ip, int port);
 		~Client();
 		int Send(std::string& outgoing);
+		// Send a payload behind a typed position header, the server reads it without parsing
+		int SendAt(float x, float y, const std::string& payload);
 		std::string Receive();
 		// Get last error from client
 		void What() const;